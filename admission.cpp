@@ -0,0 +1,238 @@
+#include "admission.h"
+#include "core.h"
+
+#include <node.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+
+#if defined(__linux__)
+  #include <dirent.h>
+#elif defined(__APPLE__)
+  #include <mach/mach.h>
+#endif
+
+using namespace v8;
+
+// Minimum time between two RSS samples; walking /proc is not free
+#define RSS_SAMPLE_NS (250 * 1000 * 1000ULL)
+
+namespace nodium {
+
+AdmissionLimits Admission::limits = { 0, 0, 0 };
+size_t Admission::cachedRss = 0;
+uint64_t Admission::sampledAt = 0;
+
+void Admission::Init(Handle<Object> target)
+{
+	NODE_SET_METHOD(target, "setAdmissionLimits", SetLimits);
+	NODE_SET_METHOD(target, "admission", Query);
+}
+
+AdmissionVerdict Admission::Check(unsigned queued)
+{
+	if(limits.maxQueued && queued >= limits.maxQueued)
+		return ADMIT_OVER_QUEUE;
+
+	if(limits.maxViews && Core::ViewCount() >= limits.maxViews)
+		return ADMIT_OVER_VIEWS;
+
+	if(limits.maxRssBytes && Rss() >= limits.maxRssBytes)
+		return ADMIT_OVER_MEMORY;
+
+	return ADMIT_OK;
+}
+
+const char* Admission::Describe(AdmissionVerdict verdict)
+{
+	switch(verdict)
+	{
+	case ADMIT_OVER_VIEWS:
+		return "views";
+	case ADMIT_OVER_QUEUE:
+		return "queue";
+	case ADMIT_OVER_MEMORY:
+		return "memory";
+	default:
+		return "ok";
+	}
+}
+
+size_t Admission::Rss()
+{
+	uint64_t now = uv_hrtime();
+
+	if(sampledAt == 0 || now - sampledAt >= RSS_SAMPLE_NS)
+	{
+		cachedRss = SampleRss();
+		sampledAt = now;
+	}
+
+	return cachedRss;
+}
+
+#if defined(__linux__)
+
+size_t Admission::SampleRss()
+{
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	std::multimap<long, long> children;
+	std::map<long, size_t> rss;
+
+	DIR* proc = opendir("/proc");
+
+	if(proc == NULL)
+		return 0;
+
+	struct dirent* entry;
+
+	while((entry = readdir(proc)) != NULL)
+	{
+		if(entry->d_name[0] < '0' || entry->d_name[0] > '9')
+			continue;
+
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+
+		FILE* file = fopen(path, "r");
+
+		if(file == NULL)
+			continue;
+
+		char line[1024];
+		size_t length = fread(line, 1, sizeof(line) - 1, file);
+		fclose(file);
+		line[length] = '\0';
+
+		// the command name may contain spaces; fields resume after its ')'
+		char* fields = strrchr(line, ')');
+
+		if(fields == NULL)
+			continue;
+
+		long pid = atol(entry->d_name);
+		long ppid = 0;
+		long pages = 0;
+
+		// state ppid pgrp session tty tpgid flags minflt cminflt majflt
+		// cmajflt utime stime cutime cstime priority nice threads
+		// itrealvalue starttime vsize rss
+		if(sscanf(fields + 1, " %*c %ld %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+				  "%*u %*u %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+				  &ppid, &pages) != 2)
+			continue;
+
+		children.insert(std::make_pair(ppid, pid));
+		rss[pid] = (size_t)pages * pageSize;
+	}
+
+	closedir(proc);
+
+	// sum ourselves and everything we spawned, transitively
+	size_t total = 0;
+	std::vector<long> pending(1, (long)getpid());
+
+	while(!pending.empty())
+	{
+		long pid = pending.back();
+		pending.pop_back();
+
+		total += rss[pid];
+
+		std::pair<std::multimap<long, long>::iterator,
+				  std::multimap<long, long>::iterator> range = children.equal_range(pid);
+
+		for(std::multimap<long, long>::iterator it = range.first; it != range.second; ++it)
+			pending.push_back(it->second);
+	}
+
+	return total;
+}
+
+#elif defined(__APPLE__)
+
+size_t Admission::SampleRss()
+{
+	size_t total = 0;
+
+	task_basic_info_data_t info;
+	mach_msg_type_number_t count = TASK_BASIC_INFO_COUNT;
+
+	if(task_info(mach_task_self(), TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+		total += info.resident_size;
+
+	// other tasks' memory is off limits without privileges; ask ps
+	FILE* ps = popen("ps -A -o ppid= -o rss=", "r");
+
+	if(ps == NULL)
+		return total;
+
+	long self = (long)getpid();
+	long ppid;
+	long kilobytes;
+
+	while(fscanf(ps, "%ld %ld", &ppid, &kilobytes) == 2)
+	{
+		if(ppid == self)
+			total += (size_t)kilobytes * 1024;
+	}
+
+	pclose(ps);
+
+	return total;
+}
+
+#else
+
+size_t Admission::SampleRss()
+{
+	return 0;
+}
+
+#endif
+
+Handle<Value> Admission::SetLimits(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!args[0]->IsObject())
+		return ThrowException(Exception::TypeError(
+			String::New("setAdmissionLimits expects an options object")));
+
+	Local<Object> options = args[0]->ToObject();
+	Local<Value> maxViews = options->Get(String::NewSymbol("maxViews"));
+	Local<Value> maxQueued = options->Get(String::NewSymbol("maxQueued"));
+	Local<Value> maxRss = options->Get(String::NewSymbol("maxRss"));
+
+	if(maxViews->IsNumber())
+		limits.maxViews = maxViews->Uint32Value();
+
+	if(maxQueued->IsNumber())
+		limits.maxQueued = maxQueued->Uint32Value();
+
+	if(maxRss->IsNumber())
+		limits.maxRssBytes = (size_t)maxRss->NumberValue();
+
+	return Undefined();
+}
+
+Handle<Value> Admission::Query(const Arguments& args)
+{
+	HandleScope scope;
+
+	unsigned queued = args[0]->IsNumber() ? args[0]->Uint32Value() : 0;
+	AdmissionVerdict verdict = Check(queued);
+
+	Local<Object> result = Object::New();
+	result->Set(String::NewSymbol("verdict"), String::New(Describe(verdict)));
+	result->Set(String::NewSymbol("views"), Integer::NewFromUnsigned((uint32_t)Core::ViewCount()));
+	result->Set(String::NewSymbol("queued"), Integer::NewFromUnsigned(queued));
+	result->Set(String::NewSymbol("rss"), Number::New((double)Rss()));
+
+	return scope.Close(result);
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef NODIUM_ADMISSION_H
+#define NODIUM_ADMISSION_H
+
+#include <v8.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nodium {
+
+// Load-shedding thresholds consulted before new work is started. A limit of
+// zero disables that check.
+struct AdmissionLimits
+{
+	unsigned maxViews;
+	unsigned maxQueued;
+	size_t maxRssBytes;
+};
+
+enum AdmissionVerdict
+{
+	ADMIT_OK = 0,
+	ADMIT_OVER_VIEWS,
+	ADMIT_OVER_QUEUE,
+	ADMIT_OVER_MEMORY
+};
+
+class Admission
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+	// Decides whether one more unit of work may start given how many are
+	// already waiting behind it.
+	static AdmissionVerdict Check(unsigned queued);
+
+	// Resident set size of this process plus every descendant (the
+	// AwesomiumProcess renderers), sampled at most every few hundred ms.
+	static size_t Rss();
+
+	static const char* Describe(AdmissionVerdict verdict);
+
+private:
+	static v8::Handle<v8::Value> SetLimits(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Query(const v8::Arguments& args);
+
+	static size_t SampleRss();
+
+	static AdmissionLimits limits;
+	static size_t cachedRss;
+	static uint64_t sampledAt;
+};
+
+}
+
+#endif
@@ -1,11 +1,110 @@
-var bindings = require("./build/default/nodeium");
+var EventEmitter = require("events").EventEmitter;
+var bindings = require("./build/default/nodium");
+var JobQueue = require("./lib/jobs").JobQueue;
+var config = require("./lib/config");
+var input = require("./lib/input");
+var replay = require("./lib/replay");
+var routes = require("./lib/routes");
 
-var Awesomium = bindings.Nodeium;
+// native views report listener callbacks through emit()
+bindings.WebView.prototype.__proto__ = EventEmitter.prototype;
+
+var GET_TEXT_TIMEOUT = 30000;
+
+// Calls back with the current page's text as a UTF-8 Buffer, waiting for
+// the next 'contents' event if the page has not delivered it yet. A
+// main-frame navigation hands the wait over to the new page and starts
+// timeout (ms) over; it fails with ETIMEDOUT if no text arrives in time.
+bindings.WebView.prototype.getText = function (callback, timeout){
+	var self = this;
+	var text = this.pageContents();
+	var timer;
+
+	timeout = timeout || GET_TEXT_TIMEOUT;
+
+	if(text !== undefined){
+		process.nextTick(function (){
+			callback(null, text, self.getURL());
+		});
+		return;
+	}
+
+	function done(err, text, url){
+		clearTimeout(timer);
+		self.removeListener("contents", onContents);
+		self.removeListener("crashed", onCrashed);
+		self.removeListener("beginNavigation", onNavigation);
+		callback(err, text, url);
+	}
+
+	function onContents(url, text){
+		done(null, text, url);
+	}
+
+	function onCrashed(){
+		var err = new Error("WebView crashed");
+		err.code = "ECRASHED";
+		done(err);
+	}
+
+	function onTimeout(){
+		var err = new Error("Page text did not arrive");
+		err.code = "ETIMEDOUT";
+		done(err);
+	}
+
+	function onNavigation(url, frameName){
+		if(frameName)
+			return;
+
+		clearTimeout(timer);
+		timer = setTimeout(onTimeout, timeout);
+	}
+
+	this.on("contents", onContents);
+	this.on("crashed", onCrashed);
+	this.on("beginNavigation", onNavigation);
+	timer = setTimeout(onTimeout, timeout);
+};
+
+// Serves requests matching pattern from a Buffer or a handler; see
+// lib/routes.js
+bindings.WebView.prototype.route = function (pattern, handler, options){
+	routes.route(this, pattern, handler, options);
+};
+
+bindings.WebView.prototype.unroute = function (pattern){
+	return routes.unroute(this, pattern);
+};
+
+exports.bindings = bindings;
+exports.WebView = bindings.WebView;
+
+// Encoders for view.dispatchInput()
+exports.input = input;
+
+// Must run before the first WebView is created; see README for options
+exports.init = function (options){
+	return config.init(bindings, options);
+};
 
 exports.createBrowser = function (h, w){
-	var a = new Awesomium();
-	
-	a.createBrowser(h, w);
+	return new bindings.WebView(w, h);
+};
+
+// Native screenshot pipeline; emits capture(index, url, data),
+// failed(index, url, reason) and end(summary)
+bindings.CaptureBatch.prototype.__proto__ = EventEmitter.prototype;
+
+exports.captureBatch = function (urls, options){
+	return new bindings.CaptureBatch(urls, options || {});
+};
+
+// Replays a log from view.stopRecording() on options.views fresh views
+exports.replayInput = function (log, options, callback){
+	replay.replay(bindings, log, options, callback);
+};
 
-	return a;
+exports.createQueue = function (options){
+	return new JobQueue(bindings, options);
 };
@@ -0,0 +1,445 @@
+#include "batch.h"
+#include "core.h"
+#include "jpeg.h"
+#include "buffer.h"
+#include "metrics.h"
+#include "pool.h"
+#include "transcode.h"
+
+#include <string.h>
+
+using namespace node;
+using namespace v8;
+
+#define DEFAULT_WIDTH 1280
+#define DEFAULT_HEIGHT 960
+#define DEFAULT_CONCURRENCY 4
+#define DEFAULT_QUALITY 85
+#define DEFAULT_TIMEOUT_MS 30000
+
+// How long a loaded page may stay unpainted before it is captured anyway
+#define PAINT_GRACE_MS 1000
+
+namespace nodium {
+
+Persistent<FunctionTemplate> CaptureBatch::constructor;
+
+void CaptureBatch::Init(Handle<Object> target)
+{
+	HandleScope scope;
+
+	Local<FunctionTemplate> t = FunctionTemplate::New(New);
+	constructor = Persistent<FunctionTemplate>::New(t);
+	constructor->InstanceTemplate()->SetInternalFieldCount(1);
+	constructor->SetClassName(String::NewSymbol("CaptureBatch"));
+
+	NODE_SET_PROTOTYPE_METHOD(constructor, "cancel", Cancel);
+
+	target->Set(String::NewSymbol("CaptureBatch"), constructor->GetFunction());
+}
+
+CaptureBatch::CaptureBatch(const std::vector<std::string>& urls, const Options& options)
+	: urls(urls), options(options), next(0), encoding(0), captured(0), failed(0),
+	  startedAt(0), running(false), cancelled(false)
+{
+}
+
+CaptureBatch::~CaptureBatch()
+{
+	// only reachable once Finish() has released the pool
+}
+
+static uint64_t GetNumber(Local<Object> options, const char* name, uint64_t fallback)
+{
+	Local<Value> value = options->Get(String::NewSymbol(name));
+	return value->IsNumber() && value->IntegerValue() >= 0 ? (uint64_t)value->IntegerValue() : fallback;
+}
+
+// new CaptureBatch(urls, { width, height, concurrency, quality, format:
+//                          "jpeg" | "raw", timeout, delay, thumbnails,
+//                          filter, thumbnailQuality, full, stable })
+Handle<Value> CaptureBatch::New(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!args.IsConstructCall())
+		return ThrowException(Exception::TypeError(
+			String::New("Use the new operator to create a CaptureBatch")));
+
+	if(!args[0]->IsArray())
+		return ThrowException(Exception::TypeError(
+			String::New("captureBatch expects an array of URLs")));
+
+	Local<Array> list = Local<Array>::Cast(args[0]);
+	std::vector<std::string> urls(list->Length());
+
+	for(uint32_t i = 0; i < list->Length(); i++)
+	{
+		String::Utf8Value url(list->Get(i));
+		urls[i].assign(*url, url.length());
+	}
+
+	Local<Object> given = args[1]->IsObject() ? args[1]->ToObject() : Object::New();
+	Options options;
+
+	options.width = (int)GetNumber(given, "width", DEFAULT_WIDTH);
+	options.height = (int)GetNumber(given, "height", DEFAULT_HEIGHT);
+	options.concurrency = (unsigned)GetNumber(given, "concurrency", DEFAULT_CONCURRENCY);
+	options.quality = (int)GetNumber(given, "quality", DEFAULT_QUALITY);
+	options.timeout = GetNumber(given, "timeout", DEFAULT_TIMEOUT_MS);
+	options.delay = GetNumber(given, "delay", 0);
+	options.raw = false;
+	options.full = true;
+
+	Local<Value> stable = given->Get(String::NewSymbol("stable"));
+	options.stable = stable->IsObject() || stable->BooleanValue();
+	options.stability.Parse(stable);
+
+	Local<Value> format = given->Get(String::NewSymbol("format"));
+
+	if(!format->IsUndefined())
+	{
+		String::Utf8Value name(format);
+
+		if(strcmp(*name, "raw") == 0)
+			options.raw = true;
+		else if(strcmp(*name, "jpeg") != 0)
+			return ThrowException(Exception::RangeError(
+				String::New("format must be \"jpeg\" or \"raw\"")));
+	}
+
+	Local<Value> thumbnails = given->Get(String::NewSymbol("thumbnails"));
+
+	if(!thumbnails->IsUndefined())
+	{
+		const char* error;
+
+		if(!options.thumbnails.Parse(thumbnails, given->Get(String::NewSymbol("filter")), error))
+			return ThrowException(Exception::TypeError(String::New(error)));
+
+		int quality = (int)GetNumber(given, "thumbnailQuality", options.thumbnails.quality);
+
+		if(quality >= 1 && quality <= 100)
+			options.thumbnails.quality = quality;
+
+		// only thumbnails are wanted unless full says otherwise
+		Local<Value> full = given->Get(String::NewSymbol("full"));
+		options.full = !full->IsUndefined() && full->BooleanValue();
+	}
+
+	if(options.width <= 0 || options.height <= 0)
+		return ThrowException(Exception::RangeError(
+			String::New("Capture dimensions must be positive")));
+
+	if(options.concurrency == 0)
+		options.concurrency = 1;
+
+	if(options.concurrency > urls.size())
+		options.concurrency = urls.size() > 0 ? urls.size() : 1;
+
+	if(options.quality < 1 || options.quality > 100)
+		options.quality = DEFAULT_QUALITY;
+
+	CaptureBatch* batch = new CaptureBatch(urls, options);
+	batch->Wrap(args.This());
+	batch->Start();
+
+	return args.This();
+}
+
+void CaptureBatch::Start()
+{
+	Awesomium::WebCore* webCore = Core::Get();
+
+	for(unsigned i = 0; i < options.concurrency; i++)
+	{
+		Slot* slot = new Slot();
+		slot->webView = webCore->createWebView(options.width, options.height);
+		slot->webView->setListener(slot);
+		slot->state = SLOT_IDLE;
+		slot->encoding = false;
+		slots.push_back(slot);
+	}
+
+	startedAt = uv_now(uv_default_loop());
+	running = true;
+
+	// held until end so results still have somewhere to go
+	Ref();
+	Core::AddHook(OnTick, this);
+}
+
+Handle<Value> CaptureBatch::Cancel(const Arguments& args)
+{
+	HandleScope scope;
+	CaptureBatch* batch = ObjectWrap::Unwrap<CaptureBatch>(args.This());
+
+	if(!batch->running || batch->cancelled)
+		return Undefined();
+
+	// loads in progress are dropped; captures already encoding still arrive
+	batch->cancelled = true;
+
+	for(size_t i = 0; i < batch->slots.size(); i++)
+	{
+		Slot* slot = batch->slots[i];
+
+		if(slot->state != SLOT_IDLE)
+		{
+			slot->webView->stop();
+			slot->state = SLOT_IDLE;
+		}
+	}
+
+	return Undefined();
+}
+
+void CaptureBatch::OnTick(void* data, uint64_t now)
+{
+	((CaptureBatch*)data)->Tick(now);
+}
+
+void CaptureBatch::Tick(uint64_t now)
+{
+	HandleScope scope;
+
+	for(size_t i = 0; running && i < slots.size(); i++)
+	{
+		Slot* slot = slots[i];
+
+		if(slot->state != SLOT_IDLE && slot->crashed)
+		{
+			Metrics::Count(LOADS_CRASHED);
+			Fail(slot, "crashed");
+		}
+		else if(slot->state != SLOT_IDLE && now >= slot->deadline)
+			Fail(slot, "timeout");
+		else if(slot->state == SLOT_LOADING && slot->finished)
+		{
+			Metrics::Count(LOADS_FINISHED);
+			slot->state = SLOT_SETTLING;
+			slot->readyAt = now + options.delay;
+
+			if(options.stable)
+				slot->watch.Start(options.stability, slot->readyAt);
+		}
+
+		// one capture per slot in flight; the next waits for its encoder
+		if(slot->state == SLOT_SETTLING && now >= slot->readyAt && !slot->encoding &&
+		   Settled(slot, now))
+			Capture(slot);
+
+		if(slot->state == SLOT_IDLE && !cancelled && next < urls.size())
+			Load(slot, now);
+	}
+
+	if(running && encoding == 0 && (cancelled || next == urls.size()))
+	{
+		bool idle = true;
+
+		for(size_t i = 0; i < slots.size(); i++)
+			idle = idle && slots[i]->state == SLOT_IDLE;
+
+		if(idle)
+			Finish();
+	}
+}
+
+void CaptureBatch::Load(Slot* slot, uint64_t now)
+{
+	slot->index = next++;
+	slot->state = SLOT_LOADING;
+	slot->started = false;
+	slot->finished = false;
+	slot->crashed = false;
+	slot->deadline = now + options.timeout;
+
+	Metrics::Count(LOADS_STARTED);
+	slot->webView->loadURL(urls[slot->index]);
+}
+
+bool CaptureBatch::Settled(Slot* slot, uint64_t now)
+{
+	if(options.stable)
+		return slot->watch.Poll(slot->webView, now);
+
+	return slot->webView->isDirty() || now >= slot->readyAt + PAINT_GRACE_MS;
+}
+
+void CaptureBatch::Capture(Slot* slot)
+{
+	const Awesomium::RenderBuffer* buffer;
+
+	{
+		ScopedLatency latency(RENDER);
+		buffer = slot->webView->render();
+	}
+
+	if(buffer == NULL)
+	{
+		Fail(slot, "render failed");
+		return;
+	}
+
+	// the RenderBuffer is reused by the next paint, so take a copy for
+	// the worker
+	size_t rowBytes = (size_t)buffer->width * 4;
+	Work* work = new Work();
+
+	work->request.data = work;
+	work->batch = this;
+	work->slot = slot;
+	work->index = slot->index;
+	work->width = buffer->width;
+	work->height = buffer->height;
+	work->quality = options.quality;
+	work->raw = options.raw;
+	work->full = options.full;
+	work->thumbnails = &options.thumbnails;
+	work->ok = false;
+	work->pixels = PixelPool::Acquire(rowBytes * buffer->height);
+
+	if(work->pixels == NULL)
+	{
+		delete work;
+		Fail(slot, "out of memory");
+		return;
+	}
+
+	for(int y = 0; y < buffer->height; y++)
+		memcpy(work->pixels + y * rowBytes, buffer->buffer + (size_t)y * buffer->rowSpan, rowBytes);
+
+	slot->encoding = true;
+	slot->state = SLOT_IDLE;
+	encoding++;
+
+	uv_queue_work(uv_default_loop(), &work->request, Encode, AfterEncode);
+}
+
+// Thread pool: no V8 in here
+void CaptureBatch::Encode(uv_work_t* request)
+{
+	Work* work = (Work*)request->data;
+	ScopedLatency latency(ENCODE);
+
+	work->ok = true;
+
+	if(work->full && !work->raw)
+		work->ok = EncodeJpeg(work->pixels, work->width, work->height, work->width * 4,
+							  work->quality, work->output);
+
+	if(work->ok && !work->thumbnails->sizes.empty())
+		work->ok = work->thumbnails->Encode(work->pixels, work->width, work->height,
+											work->width * 4, work->thumbnailOutput);
+}
+
+void CaptureBatch::AfterEncode(uv_work_t* request)
+{
+	HandleScope scope;
+
+	Work* work = (Work*)request->data;
+	CaptureBatch* batch = work->batch;
+
+	batch->encoding--;
+	work->slot->encoding = false;
+
+	Handle<Value> argv[5];
+	int argc = 4;
+
+	argv[1] = Integer::NewFromUnsigned((uint32_t)work->index);
+	argv[2] = ToV8(batch->urls[work->index]);
+
+	if(work->ok)
+	{
+		batch->captured++;
+		argv[0] = String::New("capture");
+
+		if(!work->full)
+			argv[3] = Null();
+		else if(work->raw)
+		{
+			// the pixels themselves go to JS, no copy
+			argv[3] = PooledBuffer(work->pixels, (size_t)work->width * work->height * 4);
+			work->pixels = NULL;
+		}
+		else
+			argv[3] = NewBuffer(work->output.data(), work->output.size());
+
+		if(!work->thumbnails->sizes.empty())
+			argv[argc++] = Thumbnails::ToV8(work->thumbnailOutput);
+	}
+	else
+	{
+		batch->failed++;
+		argv[0] = String::New("failed");
+		argv[3] = String::New("encode failed");
+	}
+
+	PixelPool::Release(work->pixels);
+	delete work;
+
+	batch->Emit(argc, argv);
+}
+
+void CaptureBatch::Fail(Slot* slot, const char* reason)
+{
+	size_t index = slot->index;
+
+	if(slot->crashed)
+	{
+		// a crashed view is not coming back; swap in a fresh one
+		slot->webView->setListener(NULL);
+		slot->webView->destroy();
+		slot->webView = Core::Get()->createWebView(options.width, options.height);
+		slot->webView->setListener(slot);
+		slot->crashed = false;
+	}
+	else
+		slot->webView->stop();
+
+	slot->state = SLOT_IDLE;
+	failed++;
+
+	Handle<Value> argv[4] = {
+		String::New("failed"),
+		Integer::NewFromUnsigned((uint32_t)index),
+		ToV8(urls[index]),
+		String::New(reason)
+	};
+
+	Emit(4, argv);
+}
+
+void CaptureBatch::Finish()
+{
+	running = false;
+	Core::RemoveHook(OnTick, this);
+
+	for(size_t i = 0; i < slots.size(); i++)
+	{
+		slots[i]->webView->setListener(NULL);
+		slots[i]->webView->destroy();
+		delete slots[i];
+	}
+
+	slots.clear();
+
+	Local<Object> summary = Object::New();
+	summary->Set(String::NewSymbol("captured"), Number::New((double)captured));
+	summary->Set(String::NewSymbol("failed"), Number::New((double)failed));
+	summary->Set(String::NewSymbol("cancelled"), Boolean::New(cancelled));
+	summary->Set(String::NewSymbol("elapsed"),
+				 Number::New((double)(uv_now(uv_default_loop()) - startedAt)));
+
+	Handle<Value> argv[2] = { String::New("end"), summary };
+	Emit(2, argv);
+
+	Unref();
+}
+
+void CaptureBatch::Emit(int argc, Handle<Value>* argv)
+{
+	MakeCallback(handle_, "emit", argc, argv);
+}
+
+}
@@ -0,0 +1,136 @@
+#ifndef NODIUM_BATCH_H
+#define NODIUM_BATCH_H
+
+#include <v8.h>
+#include <node.h>
+#include <uv.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "listener.h"
+#include "thumbnail.h"
+#include "stability.h"
+
+namespace nodium {
+
+// The whole screenshot pipeline for a list of URLs, without JS in the loop:
+// a fixed pool of WebViews loads the URLs, each finished page is rendered
+// and copied on the main thread, and conversion and encoding run on the
+// libuv thread pool. Results are emitted as they complete, in whatever
+// order that is: capture(index, url, data[, thumbnails]), failed(index, url,
+// reason) and finally end(summary).
+class CaptureBatch : public node::ObjectWrap
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+private:
+	struct Options
+	{
+		int width;
+		int height;
+		unsigned concurrency;
+		int quality;
+		bool raw;
+		uint64_t timeout;
+		uint64_t delay;
+
+		// JPEG thumbnails encoded alongside (or, without full, instead of)
+		// the full-size capture
+		Thumbnails thumbnails;
+		bool full;
+
+		// wait for the page to stop changing instead of for its first paint
+		bool stable;
+		StabilityOptions stability;
+	};
+
+	enum SlotState { SLOT_IDLE, SLOT_LOADING, SLOT_SETTLING };
+
+	// One pooled WebView; the listener only raises flags for Tick() to act
+	// on once update() has returned
+	struct Slot : public NullListener
+	{
+		Awesomium::WebView* webView;
+		SlotState state;
+		size_t index;
+		uint64_t deadline;
+		uint64_t readyAt;
+		bool started;
+		bool finished;
+		bool crashed;
+
+		// a previous capture is still being encoded
+		bool encoding;
+
+		StabilityWatch watch;
+
+		// stop() does not silence a page abandoned after a timeout, so its
+		// late onFinishLoading must not pass for the next URL's: only a
+		// load whose main frame has begun loading since Load() can finish
+		void onBeginLoading(Awesomium::WebView* caller, const std::string& url,
+							const std::wstring& frameName, int statusCode,
+							const std::wstring& mimeType)
+		{
+			if(frameName.empty())
+				started = true;
+		}
+
+		void onFinishLoading(Awesomium::WebView* caller) { finished = started; }
+		void onWebViewCrashed(Awesomium::WebView* caller) { crashed = true; }
+	};
+
+	struct Work
+	{
+		uv_work_t request;
+		CaptureBatch* batch;
+		Slot* slot;
+		size_t index;
+		unsigned char* pixels;
+		int width;
+		int height;
+		int quality;
+		bool raw;
+		bool full;
+		const Thumbnails* thumbnails;
+		std::string output;
+		std::vector<std::string> thumbnailOutput;
+		bool ok;
+	};
+
+	CaptureBatch(const std::vector<std::string>& urls, const Options& options);
+	~CaptureBatch();
+
+	static v8::Handle<v8::Value> New(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Cancel(const v8::Arguments& args);
+
+	static void OnTick(void* data, uint64_t now);
+	static void Encode(uv_work_t* request);
+	static void AfterEncode(uv_work_t* request);
+
+	void Start();
+	void Tick(uint64_t now);
+	void Load(Slot* slot, uint64_t now);
+	bool Settled(Slot* slot, uint64_t now);
+	void Capture(Slot* slot);
+	void Fail(Slot* slot, const char* reason);
+	void Finish();
+	void Emit(int argc, v8::Handle<v8::Value>* argv);
+
+	static v8::Persistent<v8::FunctionTemplate> constructor;
+
+	std::vector<std::string> urls;
+	Options options;
+	std::vector<Slot*> slots;
+	size_t next;
+	unsigned encoding;
+	size_t captured;
+	size_t failed;
+	uint64_t startedAt;
+	bool running;
+	bool cancelled;
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+// Cold vs warm page loads under different cache configurations.
+//
+//   $ node bench/cache.js [rounds] [url ...]
+//
+// The WebCore is configured once per process, so every configuration runs
+// in a child process of its own. Each round clears the cache, loads every
+// URL once (cold) and then again (warm).
+
+var path = require("path");
+var common = require("./common");
+
+// maxCacheSize 0 means no limit to WebCore, so a one byte cache is the
+// closest it gets to none at all
+var CONFIGS = {
+	"default": {},
+	"no-cache": { maxCacheSize: 1 },
+	"disk": { userDataPath: path.join(__dirname, ".cache-bench"), maxCacheSize: 64 * 1024 * 1024 },
+	"tmpfs": { tmpfs: true, maxCacheSize: 64 * 1024 * 1024 }
+};
+
+var DEFAULT_URLS = [
+	"http://www.google.com/",
+	"http://en.wikipedia.org/wiki/WebKit",
+	"http://www.github.com/"
+];
+
+function load(view, url, callback){
+	var start = Date.now();
+	view.once("finishLoading", function (){
+		callback(Date.now() - start);
+	});
+	view.loadURL(url);
+}
+
+function child(name, rounds, urls){
+	var awesomium = require("../awesomium");
+	var removeTree = require("../lib/config").removeTree;
+	var config = CONFIGS[name];
+
+	if(config.userDataPath){
+		removeTree(config.userDataPath);
+		process.on("exit", function (){ removeTree(config.userDataPath); });
+	}
+
+	awesomium.init(config);
+
+	var view = new awesomium.WebView(1024, 768);
+	var cold = [], warm = [];
+	var round = 0, index = 0;
+
+	(function next(){
+		if(index === urls.length){
+			index = 0;
+			round++;
+		}
+
+		if(round === rounds){
+			view.destroy();
+			console.log(JSON.stringify({ config: name, cold: common.median(cold), warm: common.median(warm) }));
+			return;
+		}
+
+		if(index === 0)
+			awesomium.bindings.clearCache();
+
+		var url = urls[index++];
+		load(view, url, function (coldMs){
+			cold.push(coldMs);
+			load(view, url, function (warmMs){
+				warm.push(warmMs);
+				next();
+			});
+		});
+	})();
+}
+
+function parent(rounds, urls){
+	var names = Object.keys(CONFIGS);
+
+	console.log("config      cold ms   warm ms   (median of " + rounds + " x " + urls.length + " loads)");
+
+	(function next(){
+		var name = names.shift();
+		if(!name)
+			return;
+
+		common.runChild(__filename, ["--child", name, String(rounds)].concat(urls), function (err, result){
+			if(err)
+				console.log(name + ": " + err.message);
+			else
+				console.log(common.pad(name, 12) + common.pad(result.cold, 10) + result.warm);
+			next();
+		});
+	})();
+}
+
+var argv = process.argv.slice(2);
+
+if(argv[0] === "--child")
+	child(argv[1], parseInt(argv[2], 10), argv.slice(3));
+else
+	parent(parseInt(argv[0], 10) || 3, argv.length > 1 ? argv.slice(1) : DEFAULT_URLS);
@@ -0,0 +1,49 @@
+#ifndef NODIUM_BENCH_CLOCK_H
+#define NODIUM_BENCH_CLOCK_H
+
+// Timing helpers shared by the native benchmarks
+
+#if defined(__APPLE__)
+  #include <mach/mach_time.h>
+#else
+  #include <time.h>
+#endif
+
+// Monotonic seconds
+static inline double Now()
+{
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t timebase;
+
+	if(timebase.denom == 0)
+		mach_timebase_info(&timebase);
+
+	return (double)mach_absolute_time() * timebase.numer / timebase.denom / 1e9;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+// Calls fn until budget seconds have passed, at least minRounds times, and
+// returns calls per second
+template <typename Fn>
+static double Rate(Fn& fn, double budget, size_t minRounds = 1)
+{
+	size_t rounds = 0;
+	double start = Now();
+	double elapsed;
+
+	do
+	{
+		fn();
+		rounds++;
+		elapsed = Now() - start;
+	}
+	while(elapsed < budget || rounds < minRounds);
+
+	return rounds / elapsed;
+}
+
+#endif
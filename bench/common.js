@@ -0,0 +1,49 @@
+// Helpers shared by the page-level benchmarks
+
+var spawn = require("child_process").spawn;
+
+function sorted(values){
+	return values.slice().sort(function (a, b){ return a - b; });
+}
+
+// Nearest-rank percentile, p in [0, 100]
+exports.percentile = function (values, p){
+	if(!values.length)
+		return 0;
+
+	var s = sorted(values);
+	return s[Math.min(s.length - 1, Math.max(0, Math.ceil(p / 100 * s.length) - 1))];
+};
+
+exports.median = function (values){
+	return exports.percentile(values, 50);
+};
+
+// Runs `node script args...` and calls back with the JSON object the child
+// printed on its last line of output. The WebCore is configured once per
+// process, so every configuration under test needs a child of its own.
+exports.runChild = function (script, args, callback){
+	var output = "";
+	var proc = spawn(process.execPath, [script].concat(args));
+
+	proc.stdout.on("data", function (data){ output += data; });
+	proc.stderr.pipe(process.stderr);
+	proc.on("exit", function (code){
+		var result;
+
+		try {
+			result = JSON.parse(output.trim().split("\n").pop());
+		} catch(e){
+			return callback(new Error(script + " exited with " + code));
+		}
+
+		callback(null, result);
+	});
+};
+
+exports.pad = function (value, width){
+	value = String(value);
+	while(value.length < width)
+		value += " ";
+	return value;
+};
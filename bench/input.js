@@ -0,0 +1,106 @@
+// Interactive throughput: records one input session and replays it on a
+// pool of views.
+//
+//   $ node bench/input.js [--views 4] [--keys 500] [--speed 0]
+//                         [--single-process]   (Windows only)
+//
+// A view loads pages/form.html, clicks into its textarea and type()s --keys
+// characters 5 ms apart, with startRecording() on. The log is then
+// replayed on --views fresh views at once, at --speed (1 repeats the
+// recorded timing, 0 injects as fast as the update ticks allow). Prints the log size and the replay report as
+// JSON.
+
+var common = require("./common");
+var server = require("./server");
+
+var UPDATE_INTERVAL = 2;
+
+// where pages/form.html puts its textarea
+var TEXTAREA_X = 40, TEXTAREA_Y = 40;
+
+function option(argv, name, fallback){
+	var index = argv.indexOf("--" + name);
+	return index !== -1 && index + 1 < argv.length ? argv[index + 1] : fallback;
+}
+
+// Letters, capitals, digits and punctuation, so shifted keys are covered
+function text(keys){
+	var sample = "The quick brown fox, 42 times: jumps over the lazy dog! ";
+	var out = "";
+
+	while(out.length < keys)
+		out += sample;
+
+	return out.slice(0, keys);
+}
+
+function record(awesomium, url, keys, callback){
+	var view = new awesomium.WebView(1024, 768);
+
+	view.once("finishLoading", function (){
+		var start = Date.now();
+
+		view.startRecording();
+		view.dispatchInput(awesomium.input.encode(awesomium.input.click(TEXTAREA_X, TEXTAREA_Y)));
+		view.type(text(keys), { delayMs: 5 });
+
+		view.once("inputDone", function (){
+			var log = view.stopRecording();
+			var elapsed = Date.now() - start;
+
+			view.destroy();
+			callback(log, elapsed);
+		});
+	});
+
+	view.loadURL(url);
+}
+
+function run(argv){
+	var views = parseInt(option(argv, "views", 4), 10);
+	var keys = parseInt(option(argv, "keys", 500), 10);
+	var speed = parseFloat(option(argv, "speed", 0));
+
+	var singleProcess = argv.indexOf("--single-process") !== -1;
+
+	// WebCore ignores forceSingleProcess outside Windows
+	if(singleProcess && process.platform !== "win32"){
+		console.error("--single-process is only supported on Windows; using child processes");
+		singleProcess = false;
+	}
+
+	var awesomium = require("../awesomium");
+	awesomium.init({
+		updateInterval: UPDATE_INTERVAL,
+		forceSingleProcess: singleProcess
+	});
+
+	var fixtures = server.createServer({ latency: 0, bandwidth: 0 });
+
+	fixtures.listen(0, "127.0.0.1", function (){
+		var url = "http://127.0.0.1:" + fixtures.address().port + "/form.html";
+
+		record(awesomium, url, keys, function (log, recordMs){
+			awesomium.replayInput(log, { views: views, url: url, speed: speed }, function (err, report){
+				fixtures.close();
+
+				if(err)
+					throw err;
+
+				console.log(JSON.stringify({
+					keys: keys,
+					logBytes: log.length,
+					recordMs: recordMs,
+					speed: speed,
+					replay: report,
+					sessionMs: {
+						p50: common.percentile(report.sessions, 50),
+						max: common.percentile(report.sessions, 100)
+					}
+				}, null, 2));
+			});
+		});
+	});
+}
+
+run(process.argv.slice(2));
@@ -0,0 +1,139 @@
+// Page-load latency through the binding, against the local fixture server.
+//
+//   $ node bench/latency.js [--views 4] [--samples 100] [--latency 20]
+//                           [--bandwidth 1000000] [--pages a.html,b.html]
+//                           [--single-process]
+//
+// N views load the fixture pages round-robin until the sample count is
+// reached. Each load is timed from loadURL() to domReady, finishLoading and
+// firstPaint, and the p50/p95/p99 of every phase is printed as JSON.
+// Event times are only as fine as the WebCore update interval, which this
+// benchmark lowers to UPDATE_INTERVAL ms.
+
+var fs = require("fs");
+var path = require("path");
+var common = require("./common");
+var server = require("./server");
+
+var UPDATE_INTERVAL = 2;
+
+// how long to wait for a first paint once the page has finished loading
+var PAINT_GRACE_MS = 1000;
+
+var PHASES = ["domReady", "finishLoading", "firstPaint"];
+
+function option(argv, name, fallback){
+	var index = argv.indexOf("--" + name);
+	return index !== -1 && index + 1 < argv.length ? argv[index + 1] : fallback;
+}
+
+function summarize(values){
+	return {
+		count: values.length,
+		p50: common.percentile(values, 50),
+		p95: common.percentile(values, 95),
+		p99: common.percentile(values, 99)
+	};
+}
+
+// Loads url in view and calls back with the time of each phase relative
+// to navigation start, null for phases that never happened
+function sample(view, url, callback){
+	var start = Date.now();
+	var times = {};
+	var loaded = false, done = false, grace = null;
+
+	function finish(){
+		if(done)
+			return;
+
+		done = true;
+		clearTimeout(grace);
+		PHASES.forEach(function (phase){
+			view.removeListener(phase, listeners[phase]);
+			if(!(phase in times))
+				times[phase] = null;
+		});
+		callback(times);
+	}
+
+	var listeners = {};
+	PHASES.forEach(function (phase){
+		listeners[phase] = function (){
+			if(!(phase in times))
+				times[phase] = Date.now() - start;
+
+			if(phase === "finishLoading")
+				loaded = true;
+
+			if(loaded && "firstPaint" in times)
+				finish();
+			else if(loaded && !grace)
+				grace = setTimeout(finish, PAINT_GRACE_MS);
+		};
+		view.on(phase, listeners[phase]);
+	});
+
+	view.loadURL(url);
+}
+
+function run(argv){
+	var views = parseInt(option(argv, "views", 4), 10);
+	var samples = parseInt(option(argv, "samples", 100), 10);
+	var latency = parseInt(option(argv, "latency", 20), 10);
+	var bandwidth = parseInt(option(argv, "bandwidth", 0), 10);
+	var pages = option(argv, "pages", null);
+
+	pages = pages ? pages.split(",") : fs.readdirSync(path.join(__dirname, "pages"))
+		.filter(function (name){ return /\.html$/.test(name); }).sort();
+
+	var awesomium = require("../awesomium");
+	awesomium.init({
+		updateInterval: UPDATE_INTERVAL,
+		forceSingleProcess: argv.indexOf("--single-process") !== -1
+	});
+
+	var fixtures = server.createServer({ latency: latency, bandwidth: bandwidth });
+
+	fixtures.listen(0, "127.0.0.1", function (){
+		var base = "http://127.0.0.1:" + fixtures.address().port + "/";
+		var started = 0, finished = 0;
+		var results = {};
+		var startTime = Date.now();
+
+		PHASES.forEach(function (phase){ results[phase] = []; });
+
+		function next(view){
+			if(started === samples){
+				view.destroy();
+
+				if(++finished < views)
+					return;
+
+				fixtures.close();
+
+				var report = {
+					views: views, samples: samples, latency: latency, bandwidth: bandwidth,
+					pages: pages, wallMs: Date.now() - startTime, phases: {}
+				};
+				PHASES.forEach(function (phase){ report.phases[phase] = summarize(results[phase]); });
+				console.log(JSON.stringify(report, null, 2));
+				return;
+			}
+
+			var url = base + pages[started++ % pages.length];
+			sample(view, url, function (times){
+				PHASES.forEach(function (phase){
+					if(times[phase] !== null)
+						results[phase].push(times[phase]);
+				});
+				next(view);
+			});
+		}
+
+		for(var i = 0; i < views; i++)
+			next(new awesomium.WebView(1024, 768));
+	});
+}
+
+run(process.argv.slice(2));
@@ -0,0 +1,131 @@
+// Single-process vs multi-process rendering on the pages in bench/pages.
+//
+//   $ node bench/process.js [rounds] [--json] [--child-process-path path]
+//
+// For every page and mode this reports the median page load (loadURL to
+// finishLoading), evaluate() round trip and render() after a DOM change.
+// Each mode runs in its own child process, as forceSingleProcess can only
+// be set before the WebCore exists. WebCore only honours it on Windows, so
+// elsewhere only the multi-process mode is run. One view is loaded per
+// mode; this does not measure how either mode scales with more views.
+
+var fs = require("fs");
+var path = require("path");
+var common = require("./common");
+
+var PAGES = path.join(__dirname, "pages");
+var EVALS = 200;
+var RENDERS = 20;
+
+function timeLoad(view, url, callback){
+	var start = Date.now();
+	view.once("finishLoading", function (){
+		callback(Date.now() - start);
+	});
+	view.loadURL(url);
+}
+
+// Date.now() is too coarse for one round trip, so time a batch (in us)
+function timeEval(view){
+	var start = Date.now();
+	for(var i = 0; i < EVALS; i++)
+		view.evaluate("document.title.length + " + i);
+	return (Date.now() - start) * 1000 / EVALS;
+}
+
+function timeRender(view){
+	var total = 0;
+	for(var i = 0; i < RENDERS; i++){
+		// evaluate() waits for the change to land, render() then has to paint it
+		view.evaluate("document.body.style.backgroundColor = \"#" + (i % 2 ? "fff" : "eee") + "\"");
+		var start = Date.now();
+		view.render();
+		total += Date.now() - start;
+	}
+	return total * 1000 / RENDERS;
+}
+
+function child(mode, rounds, childProcessPath){
+	var awesomium = require("../awesomium");
+	var config = { forceSingleProcess: mode === "single" };
+
+	if(childProcessPath)
+		config.childProcessPath = childProcessPath;
+
+	awesomium.init(config);
+
+	var view = new awesomium.WebView(1024, 768);
+	var pages = fs.readdirSync(PAGES).filter(function (name){ return /\.html$/.test(name); }).sort();
+	var result = { mode: mode, pages: {} };
+	var page = 0, round = 0;
+	var load = [], evals = [], render = [];
+
+	(function next(){
+		if(round === rounds){
+			result.pages[pages[page]] = {
+				load: common.median(load),
+				eval: common.median(evals),
+				render: common.median(render)
+			};
+			load = []; evals = []; render = [];
+			round = 0;
+			page++;
+		}
+
+		if(page === pages.length){
+			view.destroy();
+			console.log(JSON.stringify(result));
+			return;
+		}
+
+		timeLoad(view, "file://" + path.join(PAGES, pages[page]), function (ms){
+			load.push(ms);
+			evals.push(timeEval(view));
+			render.push(timeRender(view));
+			round++;
+			next();
+		});
+	})();
+}
+
+function parent(rounds, json, childProcessPath){
+	var modes = process.platform === "win32" ? ["single", "multi"] : ["multi"];
+	var results = [];
+	var extra = childProcessPath ? [childProcessPath] : [];
+
+	(function next(){
+		var mode = modes.shift();
+
+		if(mode){
+			return common.runChild(__filename, ["--child", mode, String(rounds)].concat(extra), function (err, result){
+				if(err)
+					console.error(mode + ": " + err.message);
+				else
+					results.push(result);
+				next();
+			});
+		}
+
+		if(json)
+			return console.log(JSON.stringify(results, null, 2));
+
+		console.log("page          mode     load ms   eval us   render us   (median of " + rounds + ")");
+		results.forEach(function (result){
+			Object.keys(result.pages).forEach(function (name){
+				var page = result.pages[name];
+				console.log(common.pad(name, 14) + common.pad(result.mode, 9) + common.pad(page.load, 10) +
+					common.pad(page.eval.toFixed(1), 10) + page.render.toFixed(1));
+			});
+		});
+	})();
+}
+
+var argv = process.argv.slice(2);
+
+if(argv[0] === "--child"){
+	child(argv[1], parseInt(argv[2], 10), argv[3]);
+} else {
+	var index = argv.indexOf("--child-process-path");
+	parent(parseInt(argv[0], 10) || 5, argv.indexOf("--json") !== -1,
+		index !== -1 ? argv[index + 1] : null);
+}
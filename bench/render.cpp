@@ -0,0 +1,344 @@
+// Render and encode throughput for the capture path, per resolution.
+//
+// Measures WebView::render() on a freshly invalidated page, RenderBuffer::
+// copyTo with every depth/RGBA/flip combination, Awesomium::copyBuffers,
+// the saveToPNG/saveToJPEG encoders and the addon's own BGRA conversion,
+// in-memory JPEG encoder, thumbnail resampler and pixel copy-out (malloc
+// against the pixel pool), in frames per second. Run it from a directory
+// where the Awesomium library and AwesomiumProcess are found, like the
+// addon itself.
+//
+//   $ node-waf configure build && ./build/default/render_bench [seconds per case]
+
+#include "clock.h"
+#include "jpeg.h"
+#include "pixels.h"
+#include "scale.h"
+#include "pool.h"
+
+#include <Awesomium/WebCore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+using namespace Awesomium;
+
+// dirty renders timed per resolution; each waits for its own repaint
+#define DIRTY_RENDERS 20
+
+// how long to pump update() for a load or repaint before giving up
+#define WAIT_SECONDS 10.0
+
+// Text and gradients down the whole page, so 1920x4000 is as busy as
+// 512x512. The alt class repaints every pixel.
+static const char* PAGE =
+	"<html><head><style>"
+	"body { margin: 0; font: 14px sans-serif; background: linear-gradient(#fff, #9ab); }"
+	"body.alt { background: linear-gradient(#ba9, #fff); }"
+	"p { margin: 0 8px 8px; }"
+	"</style></head><body><script>"
+	"for (var i = 0; i < 300; i++)"
+	"  document.write('<p>' + new Array(40).join('The quick brown fox jumps over the lazy dog. ') + '</p>');"
+	"</script></body></html>";
+
+static bool Pump(WebCore& core, WebView* view, bool (*done)(WebView*))
+{
+	double deadline = Now() + WAIT_SECONDS;
+
+	while(!done(view))
+	{
+		if(Now() > deadline)
+			return false;
+
+		core.update();
+		usleep(1000);
+	}
+
+	return true;
+}
+
+static bool Loaded(WebView* view)
+{
+	return !view->isLoadingPage();
+}
+
+static bool Dirty(WebView* view)
+{
+	return view->isDirty();
+}
+
+struct CopyTo
+{
+	const RenderBuffer* buffer;
+	std::vector<unsigned char>* dest;
+	int depth;
+	bool rgba;
+	bool flip;
+
+	void operator()()
+	{
+		buffer->copyTo(&(*dest)[0], buffer->width * depth, depth, rgba, flip);
+	}
+};
+
+struct CopyBuffers
+{
+	const RenderBuffer* buffer;
+	std::vector<unsigned char>* dest;
+	int depth;
+	bool rgba;
+	bool flip;
+
+	void operator()()
+	{
+		copyBuffers(buffer->width, buffer->height, buffer->buffer, buffer->rowSpan,
+					&(*dest)[0], buffer->width * depth, depth, rgba, flip);
+	}
+};
+
+struct SavePNG
+{
+	const RenderBuffer* buffer;
+	std::wstring path;
+	bool transparent;
+
+	void operator()() { buffer->saveToPNG(path, transparent); }
+};
+
+struct SaveJPEG
+{
+	const RenderBuffer* buffer;
+	std::wstring path;
+	int quality;
+
+	void operator()() { buffer->saveToJPEG(path, quality); }
+};
+
+struct ConvertRows
+{
+	const RenderBuffer* buffer;
+	std::vector<unsigned char>* dest;
+
+	void operator()()
+	{
+		for(int y = 0; y < buffer->height; y++)
+			nodium::BgraToRgb(buffer->buffer + (size_t)y * buffer->rowSpan, buffer->width,
+							  &(*dest)[(size_t)y * buffer->width * 3]);
+	}
+};
+
+struct InMemoryJpeg
+{
+	const RenderBuffer* buffer;
+	int quality;
+	std::string out;
+
+	void operator()()
+	{
+		out.clear();
+		nodium::EncodeJpeg(buffer->buffer, buffer->width, buffer->height,
+						   buffer->rowSpan, quality, out);
+	}
+};
+
+// What the capture path does with every frame before it can move on: take
+// a block, copy the rows out of the RenderBuffer, give the block back
+struct CopyOut
+{
+	const RenderBuffer* buffer;
+	bool pooled;
+
+	void operator()()
+	{
+		size_t rowBytes = (size_t)buffer->width * 4;
+		size_t size = rowBytes * buffer->height;
+		unsigned char* pixels = pooled ? nodium::PixelPool::Acquire(size) : (unsigned char*)malloc(size);
+
+		for(int y = 0; y < buffer->height; y++)
+			memcpy(pixels + y * rowBytes, buffer->buffer + (size_t)y * buffer->rowSpan, rowBytes);
+
+		if(pooled)
+			nodium::PixelPool::Release(pixels);
+		else
+			free(pixels);
+	}
+};
+
+// Output widths keep the source aspect ratio
+struct Resample
+{
+	const RenderBuffer* buffer;
+	nodium::ScaleFilter filter;
+	std::vector<nodium::ScaleTarget> targets;
+	std::vector<unsigned char> pixels;
+
+	Resample(const RenderBuffer* buffer, nodium::ScaleFilter filter, const int* widths,
+			 size_t count)
+		: buffer(buffer), filter(filter), targets(count)
+	{
+		size_t total = 0;
+
+		for(size_t i = 0; i < count; i++)
+		{
+			targets[i].width = widths[i];
+			targets[i].height = widths[i] * buffer->height / buffer->width;
+			total += (size_t)targets[i].width * targets[i].height * 4;
+		}
+
+		pixels.resize(total);
+
+		for(size_t i = 0, offset = 0; i < count; i++)
+		{
+			targets[i].pixels = &pixels[offset];
+			offset += (size_t)targets[i].width * targets[i].height * 4;
+		}
+	}
+
+	void operator()()
+	{
+		nodium::Downscale(buffer->buffer, buffer->width, buffer->height, buffer->rowSpan,
+						  filter, targets);
+	}
+};
+
+struct RenderClean
+{
+	WebView* view;
+
+	void operator()() { view->render(); }
+};
+
+static void Report(int width, int height, const char* label, double fps)
+{
+	printf("%5dx%-5d %-34s %9.1f fps %9.1f MB/s\n", width, height, label, fps,
+		   fps * width * height * 4 / (1024.0 * 1024.0));
+}
+
+static std::wstring TempPath(const char* name)
+{
+	const char* dir = getenv("TMPDIR");
+	std::string path = std::string(dir && *dir ? dir : "/tmp") + "/" + name;
+
+	return std::wstring(path.begin(), path.end());
+}
+
+int main(int argc, char** argv)
+{
+	static const struct { int width, height; } sizes[] = {
+		{ 512, 512 },
+		{ 1024, 768 },
+		{ 1280, 1024 },
+		{ 1920, 1080 },
+		{ 1920, 4000 }
+	};
+
+	double budget = argc > 1 ? atof(argv[1]) : 0.5;
+	std::wstring pngPath = TempPath("nodium_render_bench.png");
+	std::wstring jpegPath = TempPath("nodium_render_bench.jpg");
+
+	WebCore core;
+
+	for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		int width = sizes[s].width;
+		int height = sizes[s].height;
+		WebView* view = core.createWebView(width, height);
+
+		view->loadHTML(std::string(PAGE));
+
+		if(!Pump(core, view, Loaded) || !Pump(core, view, Dirty))
+		{
+			fprintf(stderr, "%dx%d: page did not load\n", width, height);
+			view->destroy();
+			continue;
+		}
+
+		// render() of a page that just repainted everything; the wait for
+		// the repaint itself is not counted
+		double total = 0;
+		int renders = 0;
+
+		for(int i = 0; i < DIRTY_RENDERS; i++)
+		{
+			view->executeJavascript(std::string(i % 2 ? "document.body.className = ''" :
+												"document.body.className = 'alt'"));
+
+			if(!Pump(core, view, Dirty))
+				break;
+
+			double start = Now();
+			view->render();
+			total += Now() - start;
+			renders++;
+		}
+
+		if(renders > 0)
+			Report(width, height, "render (dirty)", renders / total);
+
+		RenderClean clean = { view };
+		Report(width, height, "render (clean)", Rate(clean, budget, 3));
+
+		const RenderBuffer* buffer = view->render();
+		std::vector<unsigned char> dest(width * height * 4);
+		char label[64];
+
+		for(int depth = 3; depth <= 4; depth++)
+		{
+			for(int combo = 0; combo < 4; combo++)
+			{
+				bool rgba = (combo & 1) != 0;
+				bool flip = (combo & 2) != 0;
+
+				CopyTo copyTo = { buffer, &dest, depth, rgba, flip };
+				snprintf(label, sizeof(label), "copyTo depth=%d%s%s", depth,
+						 rgba ? " rgba" : "", flip ? " flip" : "");
+				Report(width, height, label, Rate(copyTo, budget, 3));
+			}
+		}
+
+		CopyBuffers plain = { buffer, &dest, 4, false, false };
+		CopyBuffers converted = { buffer, &dest, 4, true, true };
+		Report(width, height, "copyBuffers depth=4", Rate(plain, budget, 3));
+		Report(width, height, "copyBuffers depth=4 rgba flip", Rate(converted, budget, 3));
+
+		SavePNG png = { buffer, pngPath, false };
+		SavePNG pngAlpha = { buffer, pngPath, true };
+		SaveJPEG jpeg90 = { buffer, jpegPath, 90 };
+		SaveJPEG jpeg70 = { buffer, jpegPath, 70 };
+		Report(width, height, "saveToPNG", Rate(png, budget, 3));
+		Report(width, height, "saveToPNG transparent", Rate(pngAlpha, budget, 3));
+		Report(width, height, "saveToJPEG quality=90", Rate(jpeg90, budget, 3));
+		Report(width, height, "saveToJPEG quality=70", Rate(jpeg70, budget, 3));
+
+		ConvertRows convert = { buffer, &dest };
+		InMemoryJpeg encode90 = { buffer, 90, std::string() };
+		InMemoryJpeg encode70 = { buffer, 70, std::string() };
+		Report(width, height, "BgraToRgb", Rate(convert, budget, 3));
+		Report(width, height, "EncodeJpeg quality=90 (in memory)", Rate(encode90, budget, 3));
+		Report(width, height, "EncodeJpeg quality=70 (in memory)", Rate(encode70, budget, 3));
+
+		CopyOut copyMalloc = { buffer, false };
+		CopyOut copyPooled = { buffer, true };
+		Report(width, height, "copy out (malloc)", Rate(copyMalloc, budget, 3));
+		Report(width, height, "copy out (pixel pool)", Rate(copyPooled, budget, 3));
+
+		static const int one[] = { 256 };
+		static const int three[] = { 512, 256, 128 };
+		Resample area(buffer, nodium::SCALE_AREA, one, 1);
+		Resample areaThree(buffer, nodium::SCALE_AREA, three, 3);
+		Resample lanczos(buffer, nodium::SCALE_LANCZOS, one, 1);
+		Report(width, height, "Downscale area 256w", Rate(area, budget, 3));
+		Report(width, height, "Downscale area 512w+256w+128w", Rate(areaThree, budget, 3));
+		Report(width, height, "Downscale lanczos 256w", Rate(lanczos, budget, 3));
+
+		view->destroy();
+	}
+
+	unlink(std::string(pngPath.begin(), pngPath.end()).c_str());
+	unlink(std::string(jpegPath.begin(), jpegPath.end()).c_str());
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+// Fixture server for the page-level benchmarks. Serves bench/pages over
+// HTTP with a configurable delay before the response starts (latency, ms)
+// and a cap on the transfer rate (bandwidth, bytes per second, 0 for
+// none). Both can be overridden per request with ?latency=&bandwidth=.
+// /bytes/<n>[.css|.js] answers with n bytes of filler, for payload-heavy
+// fixtures that should not live in the repository.
+
+var fs = require("fs");
+var http = require("http");
+var path = require("path");
+var url = require("url");
+
+var ROOT = path.join(__dirname, "pages");
+
+// throttled bodies are written in slices this often
+var SLICE_MS = 10;
+
+var TYPES = {
+	".html": "text/html; charset=utf-8",
+	".css": "text/css",
+	".js": "application/javascript",
+	".png": "image/png",
+	".txt": "text/plain"
+};
+
+function filler(size, ext){
+	var line = ext === ".css" ? ".filler { color: #123456; }\n" : "/* filler filler filler */\n";
+	var body = new Buffer(size);
+
+	for(var i = 0; i < size; i += line.length)
+		body.write(line.slice(0, Math.min(line.length, size - i)), i, "ascii");
+
+	return body;
+}
+
+function send(res, status, type, body, bandwidth){
+	res.writeHead(status, { "Content-Type": type, "Content-Length": body.length,
+		"Cache-Control": "no-cache" });
+
+	if(!bandwidth)
+		return res.end(body);
+
+	var slice = Math.max(1, Math.floor(bandwidth * SLICE_MS / 1000));
+	var offset = 0;
+
+	(function write(){
+		var end = Math.min(body.length, offset + slice);
+		res.write(body.slice(offset, end));
+		offset = end;
+
+		if(offset < body.length)
+			setTimeout(write, SLICE_MS);
+		else
+			res.end();
+	})();
+}
+
+// options: { latency, bandwidth }
+exports.createServer = function (options){
+	options = options || {};
+
+	return http.createServer(function (req, res){
+		var parsed = url.parse(req.url, true);
+		var latency = parseInt(parsed.query.latency || options.latency || 0, 10);
+		var bandwidth = parseInt(parsed.query.bandwidth || options.bandwidth || 0, 10);
+		var pathname = decodeURIComponent(parsed.pathname);
+		var bytes = /^\/bytes\/(\d+)(\.\w+)?$/.exec(pathname);
+
+		setTimeout(function (){
+			if(bytes){
+				var ext = bytes[2] || ".txt";
+				return send(res, 200, TYPES[ext] || TYPES[".txt"], filler(parseInt(bytes[1], 10), ext), bandwidth);
+			}
+
+			var file = path.join(ROOT, path.normalize(pathname));
+
+			if(file.indexOf(ROOT) !== 0)
+				return send(res, 403, TYPES[".txt"], new Buffer("forbidden"), 0);
+
+			fs.readFile(file, function (err, body){
+				if(err)
+					return send(res, 404, TYPES[".txt"], new Buffer("not found"), 0);
+
+				send(res, 200, TYPES[path.extname(file)] || "application/octet-stream", body, bandwidth);
+			});
+		}, latency);
+	});
+};
+
+if(require.main === module){
+	var port = parseInt(process.argv[2], 10) || 8123;
+	exports.createServer({
+		latency: parseInt(process.argv[3], 10) || 0,
+		bandwidth: parseInt(process.argv[4], 10) || 0
+	}).listen(port, "127.0.0.1", function (){
+		console.log("serving " + ROOT + " on http://127.0.0.1:" + port + "/");
+	});
+}
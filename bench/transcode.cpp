@@ -0,0 +1,196 @@
+// Microbenchmark for the string transcoding kernels in utf.cpp.
+//
+// Sizes follow what crosses the binding: URLs, small and large scripts
+// passed to executeJavascript, injected helper bundles and page text from
+// onGetPageContents. Each kernel is compared with a plain per-character
+// loop, which is what the binding used before the SIMD paths.
+//
+//   $ node-waf configure build && ./build/default/transcode_bench
+
+#include "utf.h"
+#include "clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace nodium;
+
+// Text in three flavours: pure ASCII (scripts, URLs), mostly ASCII with
+// some Latin-1 (European page text) and mostly CJK
+static std::wstring MakeText(size_t length, int flavour)
+{
+	std::wstring text;
+	text.reserve(length);
+	srand(42);
+
+	for(size_t i = 0; i < length; i++)
+	{
+		int r = rand() % 100;
+
+		if(flavour == 1 && r < 5)
+			text.push_back((wchar_t)(0xE0 + rand() % 0x1F));
+		else if(flavour == 2 && r < 70)
+			text.push_back((wchar_t)(0x4E00 + rand() % 0x5000));
+		else
+			text.push_back((wchar_t)(' ' + rand() % 95));
+	}
+
+	return text;
+}
+
+static size_t ScalarWideToUtf8(const wchar_t* src, size_t length, char* dest)
+{
+	char* out = dest;
+
+	for(size_t i = 0; i < length; i++)
+	{
+		unsigned c = (unsigned)src[i];
+
+		if(c < 0x80)
+			*out++ = (char)c;
+		else if(c < 0x800)
+		{
+			*out++ = (char)(0xC0 | (c >> 6));
+			*out++ = (char)(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			*out++ = (char)(0xE0 | (c >> 12));
+			*out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+			*out++ = (char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	return out - dest;
+}
+
+static size_t ScalarUtf16ToWide(const uint16_t* src, size_t length, wchar_t* dest)
+{
+	for(size_t i = 0; i < length; i++)
+		dest[i] = src[i];
+
+	return length;
+}
+
+static size_t ScalarWideToUtf16(const wchar_t* src, size_t length, uint16_t* dest)
+{
+	for(size_t i = 0; i < length; i++)
+		dest[i] = (uint16_t)src[i];
+
+	return length;
+}
+
+static size_t ScalarUtf8ToWide(const char* src, size_t length, wchar_t* dest)
+{
+	const unsigned char* in = (const unsigned char*)src;
+	size_t out = 0;
+
+	for(size_t i = 0; i < length; )
+	{
+		unsigned c = in[i];
+
+		if(c < 0x80)
+			i += 1;
+		else if(c < 0xE0)
+		{
+			c = ((c & 0x1F) << 6) | (in[i + 1] & 0x3F);
+			i += 2;
+		}
+		else
+		{
+			c = ((c & 0x0F) << 12) | ((in[i + 1] & 0x3F) << 6) | (in[i + 2] & 0x3F);
+			i += 3;
+		}
+
+		dest[out++] = (wchar_t)c;
+	}
+
+	return out;
+}
+
+// Repeats fn until roughly 50ms have passed and reports MB/s of input
+template <typename Fn>
+static double Throughput(Fn fn, size_t inputBytes)
+{
+	return Rate(fn, 0.05) * inputBytes / (1024.0 * 1024.0);
+}
+
+struct Case
+{
+	const wchar_t* src;
+	size_t length;
+	std::vector<char> bytes;
+	std::vector<wchar_t> wide;
+	std::vector<uint16_t> utf16;
+	std::string utf8;
+	size_t sink;
+};
+
+#define KERNEL(name, call) \
+	struct name { Case* c; void operator()() { c->sink += call; } }
+
+KERNEL(EncodeSimd, WideToUtf8(c->src, c->length, &c->bytes[0]));
+KERNEL(EncodeScalar, ScalarWideToUtf8(c->src, c->length, &c->bytes[0]));
+KERNEL(DecodeSimd, Utf8ToWide(c->utf8.data(), c->utf8.size(), &c->wide[0]));
+KERNEL(DecodeScalar, ScalarUtf8ToWide(c->utf8.data(), c->utf8.size(), &c->wide[0]));
+KERNEL(NarrowSimd, WideToUtf16(c->src, c->length, &c->utf16[0]));
+KERNEL(NarrowScalar, ScalarWideToUtf16(c->src, c->length, &c->utf16[0]));
+KERNEL(WidenSimd, Utf16ToWide(&c->utf16[0], c->length, &c->wide[0]));
+KERNEL(WidenScalar, ScalarUtf16ToWide(&c->utf16[0], c->length, &c->wide[0]));
+
+int main()
+{
+	static const struct { const char* label; size_t length; } sizes[] = {
+		{ "url", 64 },
+		{ "script", 2 * 1024 },
+		{ "large script", 32 * 1024 },
+		{ "bundle", 200 * 1024 },
+		{ "page text", 1024 * 1024 }
+	};
+	static const char* flavours[] = { "ascii", "latin", "cjk" };
+
+	printf("%-12s %-6s %9s | %-20s | %-20s | %-20s | %-20s\n", "size", "text", "chars",
+		   "wstring->utf8 MB/s", "utf8->wstring MB/s", "wstring->utf16 MB/s",
+		   "utf16->wstring MB/s");
+
+	for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		for(int f = 0; f < 3; f++)
+		{
+			std::wstring text = MakeText(sizes[s].length, f);
+
+			Case c;
+			c.src = text.data();
+			c.length = text.size();
+			c.bytes.resize(c.length * 4 + 16);
+			c.wide.resize(c.length * 2 + 16);
+			c.utf16.resize(c.length * 2 + 16);
+			c.utf8.assign(&c.bytes[0], WideToUtf8(c.src, c.length, &c.bytes[0]));
+			WideToUtf16(c.src, c.length, &c.utf16[0]);
+			c.sink = 0;
+
+			size_t wideBytes = c.length * sizeof(wchar_t);
+			EncodeSimd encodeSimd = { &c };
+			EncodeScalar encodeScalar = { &c };
+			DecodeSimd decodeSimd = { &c };
+			DecodeScalar decodeScalar = { &c };
+			NarrowSimd narrowSimd = { &c };
+			NarrowScalar narrowScalar = { &c };
+			WidenSimd widenSimd = { &c };
+			WidenScalar widenScalar = { &c };
+
+			printf("%-12s %-6s %9lu | %8.0f vs %8.0f | %8.0f vs %8.0f | %8.0f vs %8.0f | %8.0f vs %8.0f\n",
+				   sizes[s].label, flavours[f], (unsigned long)c.length,
+				   Throughput(encodeSimd, wideBytes), Throughput(encodeScalar, wideBytes),
+				   Throughput(decodeSimd, c.utf8.size()), Throughput(decodeScalar, c.utf8.size()),
+				   Throughput(narrowSimd, wideBytes), Throughput(narrowScalar, wideBytes),
+				   Throughput(widenSimd, c.length * 2), Throughput(widenScalar, c.length * 2));
+		}
+	}
+
+	printf("(kernel vs plain loop; input bytes per second)\n");
+
+	return 0;
+}
@@ -0,0 +1,283 @@
+#include "blocking.h"
+#include "metrics.h"
+
+#include <string.h>
+#include <strings.h>
+
+using namespace v8;
+
+// Beyond this many URLs a view forgets what it learned and starts over
+#define MAX_LEARNED_URLS 4096
+
+#define POLICY_TYPES 0xFF
+#define POLICY_STUB 0x100
+
+#define TYPE_SLOTS 4
+
+namespace nodium {
+
+static const struct { const char* extension; int type; } extensions[] = {
+	{ "png", RESOURCE_IMAGE }, { "jpg", RESOURCE_IMAGE }, { "jpeg", RESOURCE_IMAGE },
+	{ "gif", RESOURCE_IMAGE }, { "webp", RESOURCE_IMAGE }, { "bmp", RESOURCE_IMAGE },
+	{ "ico", RESOURCE_IMAGE }, { "svg", RESOURCE_IMAGE }, { "tif", RESOURCE_IMAGE },
+	{ "tiff", RESOURCE_IMAGE }, { "avif", RESOURCE_IMAGE },
+	{ "woff", RESOURCE_FONT }, { "woff2", RESOURCE_FONT }, { "ttf", RESOURCE_FONT },
+	{ "otf", RESOURCE_FONT }, { "eot", RESOURCE_FONT },
+	{ "mp4", RESOURCE_MEDIA }, { "m4v", RESOURCE_MEDIA }, { "webm", RESOURCE_MEDIA },
+	{ "ogg", RESOURCE_MEDIA }, { "ogv", RESOURCE_MEDIA }, { "oga", RESOURCE_MEDIA },
+	{ "mov", RESOURCE_MEDIA }, { "avi", RESOURCE_MEDIA }, { "flv", RESOURCE_MEDIA },
+	{ "mp3", RESOURCE_MEDIA }, { "m4a", RESOURCE_MEDIA }, { "aac", RESOURCE_MEDIA },
+	{ "wav", RESOURCE_MEDIA }, { "flac", RESOURCE_MEDIA }, { "swf", RESOURCE_MEDIA },
+	{ "css", RESOURCE_STYLESHEET }
+};
+
+static const struct { const char* name; int type; } typeNames[] = {
+	{ "image", RESOURCE_IMAGE },
+	{ "font", RESOURCE_FONT },
+	{ "media", RESOURCE_MEDIA },
+	{ "stylesheet", RESOURCE_STYLESHEET }
+};
+
+// Smallest valid GIF: one transparent pixel
+static const unsigned char transparentGif[] = {
+	0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x01, 0x00, 0x01, 0x00, 0x80, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0xF9, 0x04, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00,
+	0x00, 0x02, 0x02, 0x44, 0x01, 0x00, 0x3B
+};
+
+// Response sizes seen per type across all views; what a blocked request
+// of that type is assumed to have saved
+static uint64_t sampleBytes[TYPE_SLOTS];
+static uint64_t sampleCount[TYPE_SLOTS];
+
+static inline int Slot(int type)
+{
+	return __builtin_ctz(type);
+}
+
+ResourceBlocker::ResourceBlocker()
+	: policy(0), requests(0), bytes(0), estimated(0)
+{
+	pthread_mutex_init(&lock, NULL);
+}
+
+ResourceBlocker::~ResourceBlocker()
+{
+	pthread_mutex_destroy(&lock);
+}
+
+bool ResourceBlocker::Configure(Handle<Value> value, const char*& error)
+{
+	HandleScope scope;
+
+	if(value->IsNull() || value->IsUndefined())
+	{
+		policy = 0;
+		return true;
+	}
+
+	error = "setBlocking expects { types, mode } or null";
+
+	if(!value->IsObject())
+		return false;
+
+	Local<Object> options = value->ToObject();
+	Local<Value> types = options->Get(String::NewSymbol("types"));
+	Local<Value> mode = options->Get(String::NewSymbol("mode"));
+	int next = 0;
+
+	if(!types->IsArray())
+		return false;
+
+	Handle<Array> list = Handle<Array>::Cast(types);
+
+	for(uint32_t i = 0; i < list->Length(); i++)
+	{
+		String::Utf8Value name(list->Get(i));
+		int type = 0;
+
+		for(size_t k = 0; k < sizeof(typeNames) / sizeof(typeNames[0]); k++)
+		{
+			if(strcmp(*name, typeNames[k].name) == 0)
+				type = typeNames[k].type;
+		}
+
+		if(type == 0)
+		{
+			error = "Blocked types are \"image\", \"font\", \"media\" and \"stylesheet\"";
+			return false;
+		}
+
+		next |= type;
+	}
+
+	if(!mode->IsUndefined())
+	{
+		String::Utf8Value name(mode);
+
+		if(strcmp(*name, "stub") == 0)
+			next |= POLICY_STUB;
+		else if(strcmp(*name, "cancel") != 0)
+		{
+			error = "Blocking mode must be \"cancel\" or \"stub\"";
+			return false;
+		}
+	}
+
+	policy = next;
+	return true;
+}
+
+int ResourceBlocker::ClassifyURL(const std::string& url)
+{
+	size_t end = url.find_first_of("?#");
+
+	if(end == std::string::npos)
+		end = url.size();
+
+	// the host's own dots say nothing about the resource
+	size_t scheme = url.find("://");
+	size_t path = url.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+
+	if(path == std::string::npos || path >= end)
+		return RESOURCE_OTHER;
+
+	size_t dot = url.find_last_of("./", end - 1);
+
+	if(dot <= path || url[dot] != '.' || end - dot - 1 > 5)
+		return RESOURCE_OTHER;
+
+	char extension[6];
+	size_t length = end - dot - 1;
+
+	memcpy(extension, url.data() + dot + 1, length);
+	extension[length] = 0;
+
+	for(size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+	{
+		if(strcasecmp(extension, extensions[i].extension) == 0)
+			return extensions[i].type;
+	}
+
+	return RESOURCE_OTHER;
+}
+
+static bool StartsWith(const std::string& value, const char* prefix)
+{
+	return strncasecmp(value.c_str(), prefix, strlen(prefix)) == 0;
+}
+
+int ResourceBlocker::ClassifyMime(const std::string& mimeType)
+{
+	if(StartsWith(mimeType, "image/"))
+		return RESOURCE_IMAGE;
+
+	if(StartsWith(mimeType, "font/") || StartsWith(mimeType, "application/font-") ||
+	   StartsWith(mimeType, "application/x-font-") ||
+	   StartsWith(mimeType, "application/vnd.ms-fontobject"))
+		return RESOURCE_FONT;
+
+	if(StartsWith(mimeType, "video/") || StartsWith(mimeType, "audio/") ||
+	   StartsWith(mimeType, "application/x-shockwave-flash"))
+		return RESOURCE_MEDIA;
+
+	if(StartsWith(mimeType, "text/css"))
+		return RESOURCE_STYLESHEET;
+
+	return RESOURCE_OTHER;
+}
+
+bool ResourceBlocker::Block(Awesomium::ResourceRequest* request,
+							Awesomium::ResourceResponse*& response)
+{
+	int current = policy;
+
+	if(current == 0)
+		return false;
+
+	const std::string& url = request->getURL();
+	int type = ClassifyURL(url);
+
+	if(type == RESOURCE_OTHER)
+	{
+		pthread_mutex_lock(&lock);
+
+		std::map<std::string, int>::const_iterator it = learned.find(url);
+
+		if(it != learned.end())
+			type = it->second;
+
+		pthread_mutex_unlock(&lock);
+	}
+
+	if(!(type & current & POLICY_TYPES))
+		return false;
+
+	uint64_t count = sampleCount[Slot(type)];
+
+	__sync_fetch_and_add(&requests, 1);
+	Metrics::Count(BLOCKED_REQUESTS);
+
+	// with nothing of this type ever downloaded there is no estimate
+	if(count > 0)
+	{
+		__sync_fetch_and_add(&bytes, sampleBytes[Slot(type)] / count);
+		__sync_fetch_and_add(&estimated, 1);
+	}
+
+	if(!(current & POLICY_STUB))
+	{
+		request->cancel();
+		response = NULL;
+	}
+	else if(type == RESOURCE_IMAGE)
+		response = Awesomium::ResourceResponse::Create(sizeof(transparentGif),
+			(unsigned char*)transparentGif, "image/gif");
+	else
+	{
+		// Create() copies, so any readable byte will do for an empty body
+		static unsigned char empty[1];
+		response = Awesomium::ResourceResponse::Create(0, empty,
+			type == RESOURCE_STYLESHEET ? "text/css" : "application/octet-stream");
+	}
+
+	return true;
+}
+
+void ResourceBlocker::Observe(const std::string& url, const std::string& mimeType, int64_t size)
+{
+	int type = ClassifyMime(mimeType);
+
+	if(type == RESOURCE_OTHER)
+		return;
+
+	if(size > 0)
+	{
+		__sync_fetch_and_add(&sampleBytes[Slot(type)], (uint64_t)size);
+		__sync_fetch_and_add(&sampleCount[Slot(type)], 1);
+	}
+
+	// only worth remembering when the URL alone would not give it away
+	if(!(type & policy & POLICY_TYPES) || ClassifyURL(url) == type)
+		return;
+
+	pthread_mutex_lock(&lock);
+
+	if(learned.size() >= MAX_LEARNED_URLS)
+		learned.clear();
+
+	learned[url] = type;
+
+	pthread_mutex_unlock(&lock);
+}
+
+void ResourceBlocker::GetStats(uint64_t& blockedRequests, uint64_t& blockedBytes,
+								uint64_t& estimatedRequests) const
+{
+	blockedRequests = requests;
+	blockedBytes = bytes;
+	estimatedRequests = estimated;
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef NODIUM_BLOCKING_H
+#define NODIUM_BLOCKING_H
+
+#include <v8.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <Awesomium/ResourceInterceptor.h>
+#include <map>
+#include <string>
+
+namespace nodium {
+
+// Resource types a blocking policy can name, as a mask
+enum ResourceType
+{
+	RESOURCE_OTHER = 0,
+	RESOURCE_IMAGE = 1,
+	RESOURCE_FONT = 2,
+	RESOURCE_MEDIA = 4,
+	RESOURCE_STYLESHEET = 8
+};
+
+// Per-view policy that keeps requests for unwanted resource types off the
+// network, for views that only need a page's text or DOM. Requests are
+// judged by the extension of their URL path. Responses that got through
+// are judged by their MIME type, and the view remembers those URLs so
+// the next request for one is blocked too. Interceptor callbacks may
+// arrive off the main thread, so the policy is a single word and the
+// learned URLs sit behind a lock.
+class ResourceBlocker
+{
+public:
+	ResourceBlocker();
+	~ResourceBlocker();
+
+	// { types: ["image", "font", "media", "stylesheet"], mode: "cancel" |
+	// "stub" }, or null to block nothing. Cancelled requests fail like a
+	// network error; stubbed ones get a 1x1 GIF or an empty body.
+	bool Configure(v8::Handle<v8::Value> options, const char*& error);
+
+	bool Enabled() const { return policy != 0; }
+
+	// True when request is blocked; it has then been cancelled, or
+	// response holds the stand-in to return from onRequest
+	bool Block(Awesomium::ResourceRequest* request, Awesomium::ResourceResponse*& response);
+
+	// Called for every response a view sees
+	void Observe(const std::string& url, const std::string& mimeType, int64_t size);
+
+	// Requests blocked by this view, and the bytes that saved by the
+	// process-wide average size of a response of their type. Only the
+	// estimated requests, those of a type some response has shown the size
+	// of, count towards bytes.
+	void GetStats(uint64_t& requests, uint64_t& bytes, uint64_t& estimated) const;
+
+	static int ClassifyURL(const std::string& url);
+	static int ClassifyMime(const std::string& mimeType);
+
+private:
+	ResourceBlocker(const ResourceBlocker&);
+	ResourceBlocker& operator=(const ResourceBlocker&);
+
+	volatile int policy;
+	uint64_t requests;
+	uint64_t bytes;
+	uint64_t estimated;
+
+	pthread_mutex_t lock;
+	std::map<std::string, int> learned;
+};
+
+}
+
+#endif
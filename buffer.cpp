@@ -0,0 +1,64 @@
+#include "buffer.h"
+#include "pool.h"
+
+#include <string.h>
+
+using namespace node;
+using namespace v8;
+
+namespace nodium {
+
+static Persistent<Function> bufferConstructor;
+
+Local<Object> WrapBuffer(Buffer* slow, size_t length)
+{
+	HandleScope scope;
+
+	if(bufferConstructor.IsEmpty())
+	{
+		Local<Object> global = Context::GetCurrent()->Global();
+		bufferConstructor = Persistent<Function>::New(
+			Local<Function>::Cast(global->Get(String::NewSymbol("Buffer"))));
+	}
+
+	Handle<Value> argv[3] = {
+		slow->handle_,
+		Integer::NewFromUnsigned((uint32_t)length),
+		Integer::New(0)
+	};
+
+	return scope.Close(bufferConstructor->NewInstance(3, argv));
+}
+
+Local<Object> NewBuffer(const char* data, size_t length)
+{
+	HandleScope scope;
+
+	Buffer* slow = Buffer::New(length);
+
+	if(length > 0)
+		memcpy(Buffer::Data(slow->handle_), data, length);
+
+	return scope.Close(WrapBuffer(slow, length));
+}
+
+static void FreePooled(char* data, void* hint)
+{
+	V8::AdjustAmountOfExternalAllocatedMemory(-(int)PixelPool::Capacity((unsigned char*)data));
+	PixelPool::Release((unsigned char*)data);
+}
+
+Local<Object> PooledBuffer(unsigned char* block, size_t length)
+{
+	HandleScope scope;
+
+	// node only reports the memory of Buffers it allocated itself; without
+	// this V8 has no idea how much a few small wrappers keep alive
+	V8::AdjustAmountOfExternalAllocatedMemory((int)PixelPool::Capacity(block));
+
+	Buffer* slow = Buffer::New((char*)block, length, FreePooled, NULL);
+
+	return scope.Close(WrapBuffer(slow, length));
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef NODIUM_BUFFER_H
+#define NODIUM_BUFFER_H
+
+#include <v8.h>
+#include <node_buffer.h>
+
+namespace nodium {
+
+// Copies data into a new Buffer as JS knows it, i.e. a slice over a
+// SlowBuffer, just like `new Buffer(length)` would return.
+v8::Local<v8::Object> NewBuffer(const char* data, size_t length);
+
+// Exposes an existing SlowBuffer as a regular Buffer of the given length.
+v8::Local<v8::Object> WrapBuffer(node::Buffer* slow, size_t length);
+
+// Hands a PixelPool block to JS without copying it; the block returns to
+// the pool when the Buffer is garbage collected.
+v8::Local<v8::Object> PooledBuffer(unsigned char* block, size_t length);
+
+}
+
+#endif
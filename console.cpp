@@ -0,0 +1,140 @@
+#include "console.h"
+#include "transcode.h"
+
+#include <sys/time.h>
+
+#define UNCAUGHT_PREFIX L"Uncaught"
+
+namespace nodium {
+
+// Hands the strings over instead of copying them
+static void Move(ConsoleEntry& from, ConsoleEntry& to)
+{
+	to.level = from.level;
+	to.message.swap(from.message);
+	to.source.swap(from.source);
+	to.line = from.line;
+	to.time = from.time;
+}
+
+ConsoleLog::ConsoleLog()
+	: head(0), size(0), dropped(0), level(CONSOLE_LOG), filtered(false)
+{
+}
+
+ConsoleLog::~ConsoleLog()
+{
+	if(filtered)
+		regfree(&filter);
+}
+
+void ConsoleLog::SetCapacity(size_t capacity)
+{
+	std::vector<ConsoleEntry> entries;
+	dropped += Drain(entries);
+
+	size_t keep = entries.size() < capacity ? entries.size() : capacity;
+	dropped += entries.size() - keep;
+
+	ring.clear();
+	ring.resize(capacity);
+
+	for(size_t i = 0; i < keep; i++)
+		Move(entries[entries.size() - keep + i], ring[i]);
+
+	head = 0;
+	size = keep;
+}
+
+bool ConsoleLog::SetFilter(const std::string& pattern, bool ignoreCase)
+{
+	if(pattern.empty())
+	{
+		if(filtered)
+			regfree(&filter);
+
+		filtered = false;
+		return true;
+	}
+
+	regex_t compiled;
+	int flags = REG_EXTENDED | REG_NOSUB | (ignoreCase ? REG_ICASE : 0);
+
+	if(regcomp(&compiled, pattern.c_str(), flags) != 0)
+		return false;
+
+	if(filtered)
+		regfree(&filter);
+
+	filter = compiled;
+	filtered = true;
+
+	return true;
+}
+
+void ConsoleLog::Add(const std::wstring& message, const std::wstring& source, int line)
+{
+	if(ring.empty())
+		return;
+
+	ConsoleLevel messageLevel =
+		message.compare(0, sizeof(UNCAUGHT_PREFIX) / sizeof(wchar_t) - 1, UNCAUGHT_PREFIX) == 0 ?
+		CONSOLE_ERROR : CONSOLE_LOG;
+
+	if(messageLevel < level)
+		return;
+
+	std::string utf8;
+	EncodeUtf8(message.data(), message.size(), utf8);
+
+	if(filtered && regexec(&filter, utf8.c_str(), 0, NULL, 0) != 0)
+		return;
+
+	// full: the slot at head is the oldest entry and gets reused
+	size_t slot = (head + size) % ring.size();
+
+	if(size == ring.size())
+	{
+		head = (head + 1) % ring.size();
+		dropped++;
+	}
+	else
+		size++;
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	ConsoleEntry& entry = ring[slot];
+	entry.level = messageLevel;
+	entry.message.swap(utf8);
+	entry.source.clear();
+	EncodeUtf8(source.data(), source.size(), entry.source);
+	entry.line = line;
+	entry.time = now.tv_sec * 1000.0 + now.tv_usec / 1000;
+}
+
+size_t ConsoleLog::Drain(std::vector<ConsoleEntry>& out)
+{
+	out.reserve(out.size() + size);
+
+	for(size_t i = 0; i < size; i++)
+	{
+		out.push_back(ConsoleEntry());
+		Move(ring[(head + i) % ring.size()], out.back());
+	}
+
+	size_t lost = dropped;
+
+	head = 0;
+	size = 0;
+	dropped = 0;
+
+	return lost;
+}
+
+const char* ConsoleLog::Describe(ConsoleLevel level)
+{
+	return level == CONSOLE_ERROR ? "error" : "log";
+}
+
+}
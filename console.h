@@ -0,0 +1,65 @@
+#ifndef NODIUM_CONSOLE_H
+#define NODIUM_CONSOLE_H
+
+#include <regex.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+enum ConsoleLevel
+{
+	CONSOLE_LOG = 0,
+	CONSOLE_ERROR
+};
+
+struct ConsoleEntry
+{
+	ConsoleLevel level;
+	std::string message;
+	std::string source;
+	int line;
+	double time;
+};
+
+// Fixed-size ring of a view's console messages. Filled from the listener
+// without touching V8; once full the oldest entry is overwritten and
+// counted as dropped. Awesomium does not report a level, so uncaught
+// exceptions are errors and everything else is a log.
+class ConsoleLog
+{
+public:
+	ConsoleLog();
+	~ConsoleLog();
+
+	// Resizes the ring, keeping the newest entries. Zero stops capturing.
+	void SetCapacity(size_t capacity);
+	void SetLevel(ConsoleLevel minimum) { level = minimum; }
+
+	// POSIX extended regex matched against the message; empty clears it.
+	// Returns false, leaving the old filter, if the pattern does not compile.
+	bool SetFilter(const std::string& pattern, bool ignoreCase);
+
+	void Add(const std::wstring& message, const std::wstring& source, int line);
+
+	// Moves every entry, oldest first, into out and returns how many were
+	// dropped since the last drain
+	size_t Drain(std::vector<ConsoleEntry>& out);
+
+	static const char* Describe(ConsoleLevel level);
+
+private:
+	std::vector<ConsoleEntry> ring;
+	size_t head;
+	size_t size;
+	size_t dropped;
+	ConsoleLevel level;
+	regex_t filter;
+	bool filtered;
+};
+
+}
+
+#endif
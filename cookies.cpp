@@ -0,0 +1,232 @@
+#include "cookies.h"
+#include "core.h"
+#include "buffer.h"
+
+#include <node.h>
+#include <node_buffer.h>
+#include <string.h>
+#include <set>
+
+using namespace node;
+using namespace v8;
+
+// Jar layout: magic, then per origin a varint-prefixed "host/path", a
+// varint count and per cookie a flags byte and a varint-prefixed name=value
+#define JAR_MAGIC "NJR1"
+#define JAR_MAGIC_LENGTH 4
+
+#define COOKIE_SECURE 1
+#define COOKIE_HTTP_ONLY 2
+
+namespace nodium {
+
+static void PutVarint(std::string& out, size_t value)
+{
+	while(value >= 0x80)
+	{
+		out.push_back((char)(0x80 | (value & 0x7F)));
+		value >>= 7;
+	}
+
+	out.push_back((char)value);
+}
+
+static bool GetVarint(const unsigned char*& cursor, const unsigned char* end, size_t& value)
+{
+	value = 0;
+
+	for(int shift = 0; cursor < end && shift < 35; shift += 7)
+	{
+		unsigned char byte = *cursor++;
+		value |= (size_t)(byte & 0x7F) << shift;
+
+		if(!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+static void PutString(std::string& out, const std::string& value)
+{
+	PutVarint(out, value.size());
+	out.append(value);
+}
+
+static bool GetString(const unsigned char*& cursor, const unsigned char* end, std::string& value)
+{
+	size_t length;
+
+	if(!GetVarint(cursor, end, length) || length > (size_t)(end - cursor))
+		return false;
+
+	value.assign((const char*)cursor, length);
+	cursor += length;
+
+	return true;
+}
+
+// Splits a "a=1; b=2" header value into its cookies
+static void SplitCookies(const std::string& header, std::set<std::string>& cookies)
+{
+	size_t start = 0;
+
+	while(start < header.size())
+	{
+		size_t end = header.find("; ", start);
+
+		if(end == std::string::npos)
+			end = header.size();
+
+		if(end > start)
+			cookies.insert(header.substr(start, end - start));
+
+		start = end + 2;
+	}
+}
+
+void CookieJar::Init(Handle<Object> target)
+{
+	NODE_SET_METHOD(target, "exportCookies", ExportCookies);
+	NODE_SET_METHOD(target, "importCookies", ImportCookies);
+}
+
+void CookieJar::Export(const std::vector<std::string>& origins, std::string& out)
+{
+	Awesomium::WebCore* webCore = Core::Get();
+
+	out.append(JAR_MAGIC, JAR_MAGIC_LENGTH);
+	PutVarint(out, origins.size());
+
+	for(size_t i = 0; i < origins.size(); i++)
+	{
+		std::string origin = origins[i];
+		size_t scheme = origin.find("://");
+
+		if(scheme != std::string::npos)
+			origin.erase(0, scheme + 3);
+
+		if(origin.find('/') == std::string::npos)
+			origin.push_back('/');
+
+		// getCookies() returns a reference to a shared cache; copy each answer
+		std::set<std::string> plain, plainAll, secure, secureAll;
+		SplitCookies(webCore->getCookies("http://" + origin, true), plain);
+		SplitCookies(webCore->getCookies("http://" + origin, false), plainAll);
+		SplitCookies(webCore->getCookies("https://" + origin, true), secure);
+		SplitCookies(webCore->getCookies("https://" + origin, false), secureAll);
+
+		PutString(out, origin);
+		PutVarint(out, secureAll.size());
+
+		// https sees everything http sees plus the secure-only cookies
+		for(std::set<std::string>::iterator it = secureAll.begin(); it != secureAll.end(); ++it)
+		{
+			unsigned char flags = 0;
+
+			if(!plainAll.count(*it))
+				flags |= COOKIE_SECURE;
+
+			if(!secure.count(*it) && !plain.count(*it))
+				flags |= COOKIE_HTTP_ONLY;
+
+			out.push_back((char)flags);
+			PutString(out, *it);
+		}
+	}
+}
+
+int CookieJar::Import(const char* data, size_t length)
+{
+	const unsigned char* cursor = (const unsigned char*)data;
+	const unsigned char* end = cursor + length;
+
+	if(length < JAR_MAGIC_LENGTH || memcmp(cursor, JAR_MAGIC, JAR_MAGIC_LENGTH) != 0)
+		return -1;
+
+	cursor += JAR_MAGIC_LENGTH;
+
+	Awesomium::WebCore* webCore = Core::Get();
+	size_t origins;
+	int restored = 0;
+
+	if(!GetVarint(cursor, end, origins))
+		return -1;
+
+	for(size_t i = 0; i < origins; i++)
+	{
+		std::string origin;
+		size_t count;
+
+		if(!GetString(cursor, end, origin) || !GetVarint(cursor, end, count))
+			return -1;
+
+		for(size_t k = 0; k < count; k++)
+		{
+			std::string cookie;
+
+			if(cursor >= end)
+				return -1;
+
+			unsigned char flags = *cursor++;
+
+			if(!GetString(cursor, end, cookie))
+				return -1;
+
+			bool isSecure = (flags & COOKIE_SECURE) != 0;
+			cookie.append("; path=/");
+
+			if(isSecure)
+				cookie.append("; secure");
+
+			if(webCore->setCookie((isSecure ? "https://" : "http://") + origin, cookie,
+								  (flags & COOKIE_HTTP_ONLY) != 0))
+				restored++;
+		}
+	}
+
+	return restored;
+}
+
+Handle<Value> CookieJar::ExportCookies(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!args[0]->IsArray())
+		return ThrowException(Exception::TypeError(
+			String::New("exportCookies expects an array of hosts")));
+
+	Local<Array> hosts = Local<Array>::Cast(args[0]);
+	std::vector<std::string> origins;
+
+	for(uint32_t i = 0; i < hosts->Length(); i++)
+	{
+		String::Utf8Value host(hosts->Get(i));
+		origins.push_back(std::string(*host, host.length()));
+	}
+
+	std::string jar;
+	Export(origins, jar);
+
+	return scope.Close(NewBuffer(jar.data(), jar.size()));
+}
+
+Handle<Value> CookieJar::ImportCookies(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!Buffer::HasInstance(args[0]))
+		return ThrowException(Exception::TypeError(
+			String::New("importCookies expects a Buffer")));
+
+	Local<Object> jar = args[0]->ToObject();
+	int restored = Import(Buffer::Data(jar), Buffer::Length(jar));
+
+	if(restored < 0)
+		return ThrowException(Exception::Error(
+			String::New("Malformed cookie jar")));
+
+	return scope.Close(Integer::New(restored));
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef NODIUM_COOKIES_H
+#define NODIUM_COOKIES_H
+
+#include <v8.h>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+// Bulk snapshot and restore of the WebCore cookie store.
+//
+// Awesomium only answers "which cookies would this URL send", so a jar is
+// built by asking for each origin over http and https, with and without
+// HttpOnly cookies, and diffing the answers to recover the secure and
+// HttpOnly flags. Expiry and Domain attributes are not exposed and are lost:
+// restored cookies are host-only session cookies scoped to path=/.
+class CookieJar
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+	// origins are "host[/path]" or full URLs; the jar is appended to out.
+	static void Export(const std::vector<std::string>& origins, std::string& out);
+
+	// Returns the number of cookies set, or -1 if the jar is malformed.
+	static int Import(const char* data, size_t length);
+
+private:
+	static v8::Handle<v8::Value> ExportCookies(const v8::Arguments& args);
+	static v8::Handle<v8::Value> ImportCookies(const v8::Arguments& args);
+};
+
+}
+
+#endif
@@ -0,0 +1,361 @@
+#include "core.h"
+#include "view.h"
+#include "transcode.h"
+#include "metrics.h"
+#include "trace.h"
+#include "pool.h"
+#include "userscripts.h"
+
+#include <node.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+using namespace v8;
+
+// How often WebCore::update() is pumped while views are alive, unless
+// init() says otherwise. Events are only delivered this often, so it also
+// bounds how precisely JS can time them.
+#define UPDATE_INTERVAL_MS 20
+
+namespace nodium {
+
+Awesomium::WebCoreConfig Core::config;
+std::string Core::baseDirectory;
+std::string Core::customCSS;
+Awesomium::WebCore* Core::webCore = NULL;
+Core::ViewMap Core::views;
+Core::HookList Core::hooks;
+uv_timer_t Core::timer;
+uint64_t Core::interval = UPDATE_INTERVAL_MS;
+uint64_t Core::updateStart = 0;
+uint64_t Core::updateEnd = 0;
+bool Core::ticking = false;
+
+void Core::Init(Handle<Object> target)
+{
+	NODE_SET_METHOD(target, "init", Configure);
+	NODE_SET_METHOD(target, "shutdown", Shutdown);
+	NODE_SET_METHOD(target, "clearCache", ClearCache);
+
+	uv_timer_init(uv_default_loop(), &timer);
+}
+
+Awesomium::WebCore* Core::Get()
+{
+	if(webCore == NULL)
+	{
+		// global user styles ride along with the customCSS option
+		std::string css = customCSS;
+		UserScripts::AppendGlobalCSS(css);
+
+		if(!css.empty())
+			config.setCustomCSS(css);
+
+		webCore = new Awesomium::WebCore(config);
+
+		if(!baseDirectory.empty())
+			webCore->setBaseDirectory(baseDirectory);
+	}
+
+	return webCore;
+}
+
+bool Core::Shutdown()
+{
+	// a running captureBatch owns WebViews that only its hook accounts for
+	if(!views.empty() || !hooks.empty())
+		return false;
+
+	delete webCore;
+	webCore = NULL;
+
+	// nothing is left to pump
+	Schedule();
+
+	return true;
+}
+
+void Core::Attach(View* view)
+{
+	Get();
+	views[view->id()] = view;
+	Schedule();
+}
+
+void Core::Detach(View* view)
+{
+	views.erase(view->id());
+	Schedule();
+}
+
+void Core::AddHook(TickHook hook, void* data)
+{
+	Get();
+	hooks.push_back(std::make_pair(hook, data));
+	Schedule();
+}
+
+void Core::RemoveHook(TickHook hook, void* data)
+{
+	HookList::iterator it = std::find(hooks.begin(), hooks.end(), std::make_pair(hook, data));
+
+	if(it != hooks.end())
+		hooks.erase(it);
+
+	Schedule();
+}
+
+void Core::Schedule()
+{
+	bool busy = !views.empty() || !hooks.empty();
+
+	if(busy && !ticking)
+		uv_timer_start(&timer, OnTick, interval, interval);
+	else if(!busy && ticking)
+		uv_timer_stop(&timer);
+
+	ticking = busy;
+}
+
+size_t Core::ViewCount()
+{
+	return views.size();
+}
+
+void Core::LastUpdate(uint64_t& start, uint64_t& end)
+{
+	start = updateStart;
+	end = updateEnd;
+}
+
+static bool GetOption(Local<Object> options, const char* name, Local<Value>& value)
+{
+	value = options->Get(String::NewSymbol(name));
+	return !value->IsUndefined();
+}
+
+static std::string Utf8(Handle<Value> value)
+{
+	String::Utf8Value utf8(value);
+	return std::string(*utf8, utf8.length());
+}
+
+static bool ReadFile(const std::string& path, std::string& out)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if(file == NULL)
+		return false;
+
+	char chunk[4096];
+	size_t length;
+
+	while((length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		out.append(chunk, length);
+
+	bool ok = !ferror(file);
+	fclose(file);
+
+	return ok;
+}
+
+// init({ ... }) maps one to one onto Awesomium::WebCoreConfig, plus
+// baseDirectory and updateInterval which belong to the WebCore itself and
+// pixelPoolRetain for the pixel pool
+Handle<Value> Core::Configure(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(webCore != NULL)
+		return ThrowException(Exception::Error(
+			String::New("init() must be called before the first WebView is created")));
+
+	if(!args[0]->IsObject())
+		return ThrowException(Exception::TypeError(
+			String::New("init expects an options object")));
+
+	Local<Object> options = args[0]->ToObject();
+	Local<Value> value;
+	Awesomium::WebCoreConfig result;
+
+	if(GetOption(options, "enablePlugins", value))
+		result.setEnablePlugins(value->BooleanValue());
+
+	if(GetOption(options, "enableJavascript", value))
+		result.setEnableJavascript(value->BooleanValue());
+
+	if(GetOption(options, "enableDatabases", value))
+		result.setEnableDatabases(value->BooleanValue());
+
+	if(GetOption(options, "userDataPath", value))
+		result.setUserDataPath(Utf8(value));
+
+	if(GetOption(options, "pluginPath", value))
+		result.setPluginPath(Utf8(value));
+
+	if(GetOption(options, "logPath", value))
+		result.setLogPath(Utf8(value));
+
+	if(GetOption(options, "logLevel", value))
+	{
+		std::string level = Utf8(value);
+
+		if(level == "none")
+			result.setLogLevel(Awesomium::LOG_NONE);
+		else if(level == "verbose")
+			result.setLogLevel(Awesomium::LOG_VERBOSE);
+		else if(level == "normal")
+			result.setLogLevel(Awesomium::LOG_NORMAL);
+		else
+			return ThrowException(Exception::RangeError(
+				String::New("logLevel must be \"none\", \"normal\" or \"verbose\"")));
+	}
+
+	if(GetOption(options, "forceSingleProcess", value))
+		result.setForceSingleProcess(value->BooleanValue());
+
+	if(GetOption(options, "childProcessPath", value))
+		result.setChildProcessPath(ToWide(value));
+
+	if(GetOption(options, "autoDetectEncoding", value))
+		result.setEnableAutoDetectEncoding(value->BooleanValue());
+
+	if(GetOption(options, "acceptLanguage", value))
+		result.setAcceptLanguageOverride(Utf8(value));
+
+	if(GetOption(options, "defaultCharset", value))
+		result.setDefaultCharsetOverride(Utf8(value));
+
+	if(GetOption(options, "userAgent", value))
+		result.setUserAgentOverride(Utf8(value));
+
+	if(GetOption(options, "proxyServer", value))
+		result.setProxyServer(Utf8(value));
+
+	if(GetOption(options, "proxyConfigScript", value))
+		result.setProxyConfigScript(Utf8(value));
+
+	if(GetOption(options, "authServerWhitelist", value))
+		result.setAuthServerWhitelist(Utf8(value));
+
+	if(GetOption(options, "saveCacheAndCookies", value))
+		result.setSaveCacheAndCookies(value->BooleanValue());
+
+	if(GetOption(options, "maxCacheSize", value))
+		result.setMaxCacheSize(value->Int32Value());
+
+	if(GetOption(options, "disableSameOriginPolicy", value))
+		result.setDisableSameOriginPolicy(value->BooleanValue());
+
+	// kept aside rather than set, so global user styles can be appended
+	// once the WebCore is created
+	std::string css;
+
+	if(GetOption(options, "customCSS", value))
+		css = Utf8(value);
+
+	if(GetOption(options, "customCSSFile", value))
+	{
+		css.clear();
+
+		if(!ReadFile(Utf8(value), css))
+			return ThrowException(Exception::Error(
+				String::New("customCSSFile could not be read")));
+	}
+
+	int updateInterval = UPDATE_INTERVAL_MS;
+
+	if(GetOption(options, "updateInterval", value))
+	{
+		updateInterval = value->Int32Value();
+
+		if(updateInterval <= 0)
+			return ThrowException(Exception::RangeError(
+				String::New("updateInterval must be a positive number of milliseconds")));
+	}
+
+	double retain = -1;
+
+	if(GetOption(options, "pixelPoolRetain", value))
+	{
+		retain = value->NumberValue();
+
+		if(!(retain >= 0))
+			return ThrowException(Exception::RangeError(
+				String::New("pixelPoolRetain must be a number of bytes")));
+	}
+
+	if(retain >= 0)
+		PixelPool::SetRetain((size_t)retain);
+
+	config = result;
+	customCSS = css;
+	baseDirectory = GetOption(options, "baseDirectory", value) ? Utf8(value) : "";
+	interval = updateInterval;
+
+	return Undefined();
+}
+
+Handle<Value> Core::Shutdown(const Arguments& args)
+{
+	HandleScope scope;
+	return scope.Close(Boolean::New(Shutdown()));
+}
+
+Handle<Value> Core::ClearCache(const Arguments& args)
+{
+	HandleScope scope;
+	Get()->clearCache();
+	return Undefined();
+}
+
+void Core::OnTick(uv_timer_t* handle, int status)
+{
+	if(webCore == NULL)
+		return;
+
+	ScopedLatency latency(UPDATE_TICK);
+
+	updateStart = Trace::Now();
+	webCore->update();
+	updateEnd = Trace::Now();
+
+	// Listener events are queued during update() and delivered here, once
+	// Awesomium is no longer on the stack. Handlers may destroy any view, so
+	// walk a snapshot of ids and re-resolve each one before every call.
+	std::vector<unsigned> ids;
+	ids.reserve(views.size());
+
+	for(ViewMap::iterator it = views.begin(); it != views.end(); ++it)
+		ids.push_back(it->first);
+
+	for(size_t i = 0; i < ids.size(); i++)
+	{
+		ViewMap::iterator it = views.find(ids[i]);
+
+		if(it != views.end())
+			it->second->Flush();
+	}
+
+	uint64_t now = uv_now(uv_default_loop());
+
+	for(size_t i = 0; i < ids.size(); i++)
+	{
+		ViewMap::iterator it = views.find(ids[i]);
+
+		if(it != views.end())
+			it->second->Tick(now);
+	}
+
+	// hooks may remove themselves or each other
+	HookList pendingHooks(hooks);
+
+	for(size_t i = 0; i < pendingHooks.size(); i++)
+	{
+		if(std::find(hooks.begin(), hooks.end(), pendingHooks[i]) != hooks.end())
+			pendingHooks[i].first(pendingHooks[i].second, now);
+	}
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef NODIUM_CORE_H
+#define NODIUM_CORE_H
+
+#include <Awesomium/WebCore.h>
+#include <v8.h>
+#include <uv.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+class View;
+
+// Owns the process-wide Awesomium::WebCore and pumps WebCore::update() from
+// a libuv timer for as long as at least one view is alive, so an idle
+// process is still free to exit.
+class Core
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+	// Creates the WebCore on first use, with the options given to init()
+	// from JS or Awesomium's defaults.
+	static Awesomium::WebCore* Get();
+	static bool Created() { return webCore != NULL; }
+
+	// Deletes the WebCore. Fails (returns false) while views are alive or
+	// hooks, whose WebViews are not counted as views, are registered.
+	static bool Shutdown();
+
+	static void Attach(View* view);
+	static void Detach(View* view);
+	static size_t ViewCount();
+
+	// Native clients with WebViews of their own are called after every
+	// update(); the pump runs while there are views or hooks
+	typedef void (*TickHook)(void* data, uint64_t now);
+	static void AddHook(TickHook hook, void* data);
+	static void RemoveHook(TickHook hook, void* data);
+
+	// Span of the most recent WebCore::update(), in Trace::Now() time
+	static void LastUpdate(uint64_t& start, uint64_t& end);
+
+private:
+	static void OnTick(uv_timer_t* handle, int status);
+	static void Schedule();
+
+	static v8::Handle<v8::Value> Configure(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Shutdown(const v8::Arguments& args);
+	static v8::Handle<v8::Value> ClearCache(const v8::Arguments& args);
+
+	typedef std::map<unsigned, View*> ViewMap;
+	typedef std::vector<std::pair<TickHook, void*> > HookList;
+
+	static Awesomium::WebCoreConfig config;
+	static std::string baseDirectory;
+	static std::string customCSS;
+	static Awesomium::WebCore* webCore;
+	static ViewMap views;
+	static HookList hooks;
+	static uv_timer_t timer;
+	static uint64_t interval;
+	static uint64_t updateStart;
+	static uint64_t updateEnd;
+	static bool ticking;
+};
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include "gate.h"
+
+namespace nodium {
+
+CallbackGate::CallbackGate()
+	: inside(0), closed(true)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&idle, NULL);
+}
+
+CallbackGate::~CallbackGate()
+{
+	pthread_cond_destroy(&idle);
+	pthread_mutex_destroy(&lock);
+}
+
+bool CallbackGate::Enter()
+{
+	pthread_mutex_lock(&lock);
+
+	bool open = !closed;
+
+	if(open)
+		inside++;
+
+	pthread_mutex_unlock(&lock);
+
+	return open;
+}
+
+void CallbackGate::Leave()
+{
+	pthread_mutex_lock(&lock);
+
+	if(--inside == 0)
+		pthread_cond_broadcast(&idle);
+
+	pthread_mutex_unlock(&lock);
+}
+
+void CallbackGate::Close()
+{
+	pthread_mutex_lock(&lock);
+
+	closed = true;
+
+	while(inside > 0)
+		pthread_cond_wait(&idle, &lock);
+
+	pthread_mutex_unlock(&lock);
+}
+
+void CallbackGate::Open()
+{
+	pthread_mutex_lock(&lock);
+	closed = false;
+	pthread_mutex_unlock(&lock);
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef NODIUM_GATE_H
+#define NODIUM_GATE_H
+
+#include <pthread.h>
+
+namespace nodium {
+
+// Counts the callbacks Awesomium's threads have in progress on an object,
+// so the main thread can shut new ones out and wait for the rest to leave
+// before the object goes away. Calls arriving on the main thread itself
+// work the same; Close() is never entered from inside a callback.
+class CallbackGate
+{
+public:
+	CallbackGate();
+	~CallbackGate();
+
+	// Any thread. False once closed; otherwise the caller is inside until
+	// it calls Leave().
+	bool Enter();
+	void Leave();
+
+	// Main thread. Turns new callers away and returns once nobody is
+	// inside; Open() lets them in again.
+	void Close();
+	void Open();
+
+private:
+	CallbackGate(const CallbackGate&);
+	CallbackGate& operator=(const CallbackGate&);
+
+	pthread_mutex_t lock;
+	pthread_cond_t idle;
+	unsigned inside;
+	bool closed;
+};
+
+}
+
+#endif
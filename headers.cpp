@@ -0,0 +1,250 @@
+#include "headers.h"
+#include "transcode.h"
+
+#include <node.h>
+
+using namespace v8;
+
+namespace nodium {
+
+HeaderProfiles::Registry HeaderProfiles::registry;
+
+void HeaderProfiles::Init(Handle<Object> target)
+{
+	NODE_SET_METHOD(target, "defineHeaderProfile", Define);
+	NODE_SET_METHOD(target, "removeHeaderProfile", Remove);
+}
+
+HeaderProfile* HeaderProfiles::Acquire(const std::string& name)
+{
+	Registry::iterator it = registry.find(name);
+
+	if(it == registry.end())
+		return NULL;
+
+	it->second->refs++;
+	return it->second;
+}
+
+void HeaderProfiles::Release(HeaderProfile* profile)
+{
+	if(profile != NULL && --profile->refs == 0)
+		delete profile;
+}
+
+static std::string Utf8(Handle<Value> value)
+{
+	String::Utf8Value utf8(value);
+	return std::string(*utf8, utf8.length());
+}
+
+static bool ParseProfile(Handle<Value> value, HeaderProfile& profile, std::string& error)
+{
+	HandleScope scope;
+
+	if(!value->IsObject())
+	{
+		error = "defineHeaderProfile expects a name and { definitions, rules }";
+		return false;
+	}
+
+	Local<Object> options = value->ToObject();
+	Local<Value> definitions = options->Get(String::NewSymbol("definitions"));
+	Local<Value> rules = options->Get(String::NewSymbol("rules"));
+
+	if(!definitions->IsUndefined())
+	{
+		if(!definitions->IsObject())
+		{
+			error = "definitions must map names to { header: value } objects";
+			return false;
+		}
+
+		Local<Object> names = definitions->ToObject();
+		Local<Array> keys = names->GetPropertyNames();
+
+		for(uint32_t i = 0; i < keys->Length(); i++)
+		{
+			Local<Value> headers = names->Get(keys->Get(i));
+
+			if(!headers->IsObject())
+			{
+				error = "definitions must map names to { header: value } objects";
+				return false;
+			}
+
+			Awesomium::HeaderDefinition& definition = profile.definitions[Utf8(keys->Get(i))];
+			Local<Array> fields = headers->ToObject()->GetPropertyNames();
+
+			for(uint32_t k = 0; k < fields->Length(); k++)
+				definition[Utf8(fields->Get(k))] = Utf8(headers->ToObject()->Get(fields->Get(k)));
+		}
+	}
+
+	if(!rules->IsUndefined())
+	{
+		if(!rules->IsObject())
+		{
+			error = "rules must map URL wildcards to definition names";
+			return false;
+		}
+
+		Local<Object> wildcards = rules->ToObject();
+		Local<Array> keys = wildcards->GetPropertyNames();
+
+		for(uint32_t i = 0; i < keys->Length(); i++)
+		{
+			std::string name = Utf8(wildcards->Get(keys->Get(i)));
+
+			if(profile.definitions.count(name) == 0)
+			{
+				error = "Header rule refers to unknown definition \"" + name + "\"";
+				return false;
+			}
+
+			profile.rules[ToWide(keys->Get(i))] = name;
+		}
+	}
+
+	return true;
+}
+
+// defineHeaderProfile(name, { definitions: { name: { header: value } },
+//                             rules: { wildcard: definition } })
+Handle<Value> HeaderProfiles::Define(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!args[0]->IsString())
+		return ThrowException(Exception::TypeError(
+			String::New("defineHeaderProfile expects a name and { definitions, rules }")));
+
+	HeaderProfile* profile = new HeaderProfile();
+	profile->refs = 1;
+
+	std::string error;
+
+	if(!ParseProfile(args[1], *profile, error))
+	{
+		delete profile;
+		return ThrowException(Exception::TypeError(String::New(error.c_str())));
+	}
+
+	std::string name = Utf8(args[0]);
+	Registry::iterator it = registry.find(name);
+
+	if(it != registry.end())
+	{
+		Release(it->second);
+		it->second = profile;
+	}
+	else
+		registry[name] = profile;
+
+	return Undefined();
+}
+
+// removeHeaderProfile(name) returns whether there was such a profile
+Handle<Value> HeaderProfiles::Remove(const Arguments& args)
+{
+	HandleScope scope;
+
+	Registry::iterator it = registry.find(Utf8(args[0]));
+
+	if(it == registry.end())
+		return scope.Close(False());
+
+	Release(it->second);
+	registry.erase(it);
+
+	return scope.Close(True());
+}
+
+static int Diff(Awesomium::WebView* webView, const HeaderProfile* from, const HeaderProfile* to)
+{
+	static const HeaderProfile none = HeaderProfile();
+
+	if(from == NULL)
+		from = &none;
+
+	if(to == NULL)
+		to = &none;
+
+	if(from == to)
+		return 0;
+
+	int calls = 0;
+
+	for(std::map<std::wstring, std::string>::const_iterator it = from->rules.begin();
+		it != from->rules.end(); ++it)
+	{
+		std::map<std::wstring, std::string>::const_iterator kept = to->rules.find(it->first);
+
+		if(kept == to->rules.end() || kept->second != it->second)
+		{
+			webView->removeHeaderRewriteRule(it->first);
+			calls++;
+		}
+	}
+
+	for(std::map<std::string, Awesomium::HeaderDefinition>::const_iterator it =
+		to->definitions.begin(); it != to->definitions.end(); ++it)
+	{
+		std::map<std::string, Awesomium::HeaderDefinition>::const_iterator old =
+			from->definitions.find(it->first);
+
+		if(old == from->definitions.end() || old->second != it->second)
+		{
+			webView->setHeaderDefinition(it->first, it->second);
+			calls++;
+		}
+	}
+
+	// no rule refers to these any more, so emptying them is all it takes
+	for(std::map<std::string, Awesomium::HeaderDefinition>::const_iterator it =
+		from->definitions.begin(); it != from->definitions.end(); ++it)
+	{
+		if(to->definitions.count(it->first) == 0 && !it->second.empty())
+		{
+			webView->setHeaderDefinition(it->first, Awesomium::HeaderDefinition());
+			calls++;
+		}
+	}
+
+	for(std::map<std::wstring, std::string>::const_iterator it = to->rules.begin();
+		it != to->rules.end(); ++it)
+	{
+		std::map<std::wstring, std::string>::const_iterator old = from->rules.find(it->first);
+
+		if(old == from->rules.end() || old->second != it->second)
+		{
+			webView->addHeaderRewriteRule(it->first, it->second);
+			calls++;
+		}
+	}
+
+	return calls;
+}
+
+int HeaderState::Apply(Awesomium::WebView* webView, HeaderProfile* next)
+{
+	int calls = Diff(webView, profile, next);
+
+	HeaderProfiles::Release(profile);
+	profile = next;
+
+	return calls;
+}
+
+int HeaderState::Reset(Awesomium::WebView* webView)
+{
+	return Diff(webView, NULL, profile);
+}
+
+void HeaderState::Clear()
+{
+	HeaderProfiles::Release(profile);
+	profile = NULL;
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef NODIUM_HEADERS_H
+#define NODIUM_HEADERS_H
+
+#include <v8.h>
+#include <Awesomium/WebView.h>
+#include <map>
+#include <string>
+
+namespace nodium {
+
+// Header definitions and the URL wildcards that use them, parsed once and
+// shared by every view the profile is set on. Redefining or removing a
+// name leaves views that already hold the old profile untouched.
+struct HeaderProfile
+{
+	std::map<std::string, Awesomium::HeaderDefinition> definitions;
+	std::map<std::wstring, std::string> rules;
+	int refs;
+};
+
+// Process-wide registry behind defineHeaderProfile() and
+// removeHeaderProfile()
+class HeaderProfiles
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+	// Adds a reference to the named profile; NULL if there is none
+	static HeaderProfile* Acquire(const std::string& name);
+	static void Release(HeaderProfile* profile);
+
+private:
+	static v8::Handle<v8::Value> Define(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Remove(const v8::Arguments& args);
+
+	typedef std::map<std::string, HeaderProfile*> Registry;
+	static Registry registry;
+};
+
+// The profile a WebView has applied. Switching to another one only makes
+// the calls that differ between the two: rules that went away or moved
+// to another definition are removed, changed definitions are set again
+// and new rules are added.
+class HeaderState
+{
+public:
+	HeaderState() : profile(NULL) {}
+	~HeaderState() { Clear(); }
+
+	// Switches webView over to next, or to no profile for NULL, taking over
+	// a reference to it. Returns the number of WebView calls it took.
+	int Apply(Awesomium::WebView* webView, HeaderProfile* next);
+
+	// Applies the current profile in full to a WebView that has none yet,
+	// such as one recreated after hibernation
+	int Reset(Awesomium::WebView* webView);
+
+	void Clear();
+
+private:
+	HeaderState(const HeaderState&);
+	HeaderState& operator=(const HeaderState&);
+
+	HeaderProfile* profile;
+};
+
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include "input.h"
+
+#include <Awesomium/KeyboardCodes.h>
+#include <node_buffer.h>
+#include <string.h>
+
+using namespace node;
+using namespace v8;
+
+namespace nodium {
+
+bool DecodeInput(Handle<Value> value, std::vector<InputEvent>& out, const char*& error)
+{
+	if(Buffer::HasInstance(value))
+	{
+		Local<Object> log = value->ToObject();
+
+		if(!DecodeInputLog(Buffer::Data(log), Buffer::Length(log), out))
+		{
+			error = "Malformed input log";
+			return false;
+		}
+
+		return true;
+	}
+
+	if(!value->IsObject() || !value->ToObject()->HasIndexedPropertiesInExternalArrayData() ||
+	   value->ToObject()->GetIndexedPropertiesExternalArrayDataType() != kExternalIntArray)
+	{
+		error = "Input events must be an Int32Array";
+		return false;
+	}
+
+	Local<Object> array = value->ToObject();
+	const int32_t* data = (const int32_t*)array->GetIndexedPropertiesExternalArrayData();
+	int length = array->GetIndexedPropertiesExternalArrayDataLength();
+
+	if(length % INPUT_FIELDS != 0)
+	{
+		error = "Input events are records of 8 integers";
+		return false;
+	}
+
+	size_t start = out.size();
+	out.resize(start + length / INPUT_FIELDS);
+
+	for(size_t i = start; i < out.size(); i++)
+	{
+		memcpy(&out[i], data + (i - start) * INPUT_FIELDS, sizeof(InputEvent));
+
+		if(!ValidInput(out[i]))
+		{
+			out.resize(start);
+			error = "Malformed input event";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void UnpackText(int32_t packed, Awesomium::WebUChar* text)
+{
+	text[0] = (Awesomium::WebUChar)(packed & 0xFFFF);
+	text[1] = (Awesomium::WebUChar)((uint32_t)packed >> 16);
+	text[2] = 0;
+	text[3] = 0;
+}
+
+void InjectInput(Awesomium::WebView* webView, const InputEvent& event)
+{
+	switch(event.type)
+	{
+	case INPUT_MOUSE_MOVE:
+		webView->injectMouseMove(event.fields[0], event.fields[1]);
+		break;
+	case INPUT_MOUSE_DOWN:
+		webView->injectMouseDown((Awesomium::MouseButton)event.fields[0]);
+		break;
+	case INPUT_MOUSE_UP:
+		webView->injectMouseUp((Awesomium::MouseButton)event.fields[0]);
+		break;
+	case INPUT_MOUSE_WHEEL:
+		webView->injectMouseWheel(event.fields[0], event.fields[1]);
+		break;
+	case INPUT_KEY:
+	{
+		Awesomium::WebKeyboardEvent key;
+		char* identifier = key.keyIdentifier;
+
+		key.type = (Awesomium::WebKeyboardEvent::Type)(event.fields[0] & ~INPUT_SYSTEM_KEY);
+		key.isSystemKey = (event.fields[0] & INPUT_SYSTEM_KEY) != 0;
+		key.modifiers = event.fields[1];
+		key.virtualKeyCode = event.fields[2];
+		key.nativeKeyCode = event.fields[3];
+		UnpackText(event.fields[4], key.text);
+		UnpackText(event.fields[5], key.unmodifiedText);
+		Awesomium::getKeyIdentifierFromVirtualKeyCode(key.virtualKeyCode, &identifier);
+
+		webView->injectKeyboardEvent(key);
+		break;
+	}
+	}
+}
+
+// Where US punctuation lives: each OEM key with its unshifted and
+// shifted character
+static const struct { int key; char plain; char shifted; } punctuation[] = {
+	{ Awesomium::KeyCodes::AK_OEM_1, ';', ':' },
+	{ Awesomium::KeyCodes::AK_OEM_PLUS, '=', '+' },
+	{ Awesomium::KeyCodes::AK_OEM_COMMA, ',', '<' },
+	{ Awesomium::KeyCodes::AK_OEM_MINUS, '-', '_' },
+	{ Awesomium::KeyCodes::AK_OEM_PERIOD, '.', '>' },
+	{ Awesomium::KeyCodes::AK_OEM_2, '/', '?' },
+	{ Awesomium::KeyCodes::AK_OEM_3, '`', '~' },
+	{ Awesomium::KeyCodes::AK_OEM_4, '[', '{' },
+	{ Awesomium::KeyCodes::AK_OEM_5, '\\', '|' },
+	{ Awesomium::KeyCodes::AK_OEM_6, ']', '}' },
+	{ Awesomium::KeyCodes::AK_OEM_7, '\'', '"' }
+};
+
+// shifted digits, from 0 to 9
+static const char shiftedDigits[] = ")!@#$%^&*(";
+
+// The key that types c on a US keyboard, whether it takes shift and what
+// the key types without it; false for characters with no key
+static bool KeyFor(uint16_t c, int& key, bool& shift, uint16_t& unmodified)
+{
+	using namespace Awesomium::KeyCodes;
+
+	shift = false;
+	unmodified = c;
+
+	if(c >= 'a' && c <= 'z')
+		key = AK_A + (c - 'a');
+	else if(c >= 'A' && c <= 'Z')
+	{
+		key = AK_A + (c - 'A');
+		shift = true;
+		unmodified = c - 'A' + 'a';
+	}
+	else if(c >= '0' && c <= '9')
+		key = AK_0 + (c - '0');
+	else if(c == ' ')
+		key = AK_SPACE;
+	else if(c == '\t')
+		key = AK_TAB;
+	else if(c == '\r')
+		key = AK_RETURN;
+	else
+	{
+		const char* digit = c < 0x80 && c != 0 ? strchr(shiftedDigits, (char)c) : NULL;
+
+		if(digit != NULL)
+		{
+			key = AK_0 + (int)(digit - shiftedDigits);
+			shift = true;
+			unmodified = (uint16_t)('0' + (digit - shiftedDigits));
+			return true;
+		}
+
+		for(size_t i = 0; i < sizeof(punctuation) / sizeof(punctuation[0]); i++)
+		{
+			if(c == (uint16_t)punctuation[i].plain || c == (uint16_t)punctuation[i].shifted)
+			{
+				key = punctuation[i].key;
+				shift = c == (uint16_t)punctuation[i].shifted;
+				unmodified = (uint16_t)punctuation[i].plain;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+void TypeText(const uint16_t* text, size_t length, int32_t delay, std::vector<InputEvent>& out)
+{
+	static const int kinds[3] = {
+		Awesomium::WebKeyboardEvent::TYPE_KEY_DOWN,
+		Awesomium::WebKeyboardEvent::TYPE_CHAR,
+		Awesomium::WebKeyboardEvent::TYPE_KEY_UP
+	};
+
+	for(size_t i = 0; i < length; i++)
+	{
+		uint32_t units = text[i];
+		uint16_t c = text[i];
+
+		// Enter types "\r", however the line ended
+		if(c == '\n' || c == '\r')
+		{
+			if(c == '\r' && i + 1 < length && text[i + 1] == '\n')
+				i++;
+
+			c = '\r';
+			units = c;
+		}
+
+		// a surrogate pair is one keystroke typing both units
+		if(c >= 0xD800 && c <= 0xDBFF && i + 1 < length &&
+		   text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF)
+			units |= (uint32_t)text[++i] << 16;
+
+		int key = 0;
+		bool shift = false;
+		uint16_t unmodified = c;
+
+		if(units > 0xFFFF || !KeyFor(c, key, shift, unmodified))
+		{
+			key = 0;
+			shift = false;
+		}
+
+		for(int k = 0; k < 3; k++)
+		{
+			InputEvent event;
+
+			memset(&event, 0, sizeof(event));
+			event.type = INPUT_KEY;
+			event.delay = k == 0 && !out.empty() ? delay : 0;
+			event.fields[0] = kinds[k];
+			event.fields[1] = shift ? Awesomium::WebKeyboardEvent::MOD_SHIFT_KEY : 0;
+			event.fields[2] = key;
+			event.fields[4] = (int32_t)units;
+			event.fields[5] = units > 0xFFFF ? (int32_t)units : unmodified;
+
+			out.push_back(event);
+		}
+	}
+}
+
+InputRecorder::InputRecorder()
+	: last(0), active(false)
+{
+}
+
+void InputRecorder::Start(uint64_t now)
+{
+	events.clear();
+	last = now;
+	active = true;
+}
+
+void InputRecorder::Add(const InputEvent& event, uint64_t now)
+{
+	if(!active)
+		return;
+
+	events.push_back(event);
+	events.back().delay = (int32_t)(now - last);
+	last = now;
+}
+
+bool InputRecorder::Stop(std::string& out)
+{
+	if(!active)
+		return false;
+
+	EncodeInputLog(events, out);
+
+	events.clear();
+	active = false;
+
+	return true;
+}
+
+InputQueue::InputQueue()
+	: last(0)
+{
+}
+
+void InputQueue::Push(const std::vector<InputEvent>& events, uint64_t now, bool steps)
+{
+	// delays of a fresh batch count from when it arrives
+	if(queue.empty())
+		last = now;
+
+	for(size_t i = 0; i < events.size(); i++)
+	{
+		Entry entry = { events[i], steps ? (int64_t)i : -1 };
+		queue.push_back(entry);
+	}
+}
+
+void InputQueue::Clear()
+{
+	queue.clear();
+}
+
+size_t InputQueue::Pump(Awesomium::WebView* webView, uint64_t now, InputRecorder& recorder,
+						std::vector<uint32_t>& steps)
+{
+	size_t count = 0;
+
+	while(!queue.empty() && last + queue.front().event.delay <= now)
+	{
+		Entry entry = queue.front();
+		queue.pop_front();
+
+		last += entry.event.delay;
+		InjectInput(webView, entry.event);
+		recorder.Add(entry.event, now);
+		count++;
+
+		if(entry.step >= 0)
+		{
+			steps.push_back((uint32_t)entry.step);
+			break;
+		}
+	}
+
+	return count;
+}
+
+}
@@ -0,0 +1,129 @@
+#ifndef NODIUM_INPUT_H
+#define NODIUM_INPUT_H
+
+#include <v8.h>
+#include <stdint.h>
+#include <Awesomium/WebView.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+// Injected input as JS hands it over: an Int32Array of INPUT_FIELDS-wide
+// records, [type, delay, ...fields]. delay is the time in ms to wait after
+// the previous event. lib/input.js builds these arrays.
+//
+//   INPUT_MOUSE_MOVE   x, y
+//   INPUT_MOUSE_DOWN   button (Awesomium::MouseButton)
+//   INPUT_MOUSE_UP     button
+//   INPUT_MOUSE_WHEEL  vertical, horizontal
+//   INPUT_KEY          kind (WebKeyboardEvent::Type) | INPUT_SYSTEM_KEY,
+//                      modifiers, virtualKeyCode, nativeKeyCode, text,
+//                      unmodifiedText
+//
+// Key texts hold up to two UTF-16 units, the first in the low 16 bits.
+enum InputType
+{
+	INPUT_MOUSE_MOVE = 1,
+	INPUT_MOUSE_DOWN,
+	INPUT_MOUSE_UP,
+	INPUT_MOUSE_WHEEL,
+	INPUT_KEY
+};
+
+#define INPUT_FIELDS 8
+#define INPUT_SYSTEM_KEY 0x100
+
+struct InputEvent
+{
+	int32_t type;
+	int32_t delay;
+	int32_t fields[INPUT_FIELDS - 2];
+};
+
+// Fields the type uses, in order; 0 for an unknown type
+int InputFieldCount(int32_t type);
+
+// Whether the delay and the fields the type uses are in range
+bool ValidInput(const InputEvent& event);
+
+// Validates and copies the records of an Int32Array, or of an input log
+// Buffer; on bad input returns false with error set
+bool DecodeInput(v8::Handle<v8::Value> value, std::vector<InputEvent>& out, const char*& error);
+
+void InjectInput(Awesomium::WebView* webView, const InputEvent& event);
+
+// Appends the keyDown, char and keyUp events that typing the UTF-16 text
+// on a US keyboard produces, each keystroke delay ms after the one before.
+// "\r\n", "\r" and "\n" are Enter. Characters with no key of their own still
+// go through as a triplet, with virtual key code 0.
+void TypeText(const uint16_t* text, size_t length, int32_t delay, std::vector<InputEvent>& out);
+
+// Recorded sessions are kept as a compact log: "NDIN" and a version byte,
+// then for each event its type and delay as varints followed by only the
+// fields its type uses, as zigzag varints. A few bytes per event instead
+// of a record's 32.
+void EncodeInputLog(const std::vector<InputEvent>& events, std::string& out);
+bool DecodeInputLog(const char* data, size_t length, std::vector<InputEvent>& out);
+
+// Logs events as they are injected, each delayed by the time actually
+// taken since the one before, so replaying the log at 1x repeats the
+// session tick for tick
+class InputRecorder
+{
+public:
+	InputRecorder();
+
+	void Start(uint64_t now);
+	bool Active() const { return active; }
+	void Add(const InputEvent& event, uint64_t now);
+
+	// Stops recording and appends the log to out. Returns false if nothing
+	// was being recorded.
+	bool Stop(std::string& out);
+
+private:
+	std::vector<InputEvent> events;
+	uint64_t last;
+	bool active;
+};
+
+// Events waiting to be injected into one view. The delays are kept to a
+// fixed schedule, so a late tick does not push back the events after it.
+// Events whose time has come all go in the same tick, except that a step
+// ends the tick: its hook gets to see the page before anything else goes in.
+class InputQueue
+{
+public:
+	InputQueue();
+
+	// steps marks every event as a step, reported by its index in events
+	void Push(const std::vector<InputEvent>& events, uint64_t now, bool steps = false);
+	void Clear();
+	bool Empty() const { return queue.empty(); }
+
+	// Injects everything due by now, recording it if the recorder is on,
+	// and appends the indexes of any steps among them. Returns how many
+	// events went in.
+	size_t Pump(Awesomium::WebView* webView, uint64_t now, InputRecorder& recorder,
+				std::vector<uint32_t>& steps);
+
+private:
+	struct Entry
+	{
+		InputEvent event;
+
+		// index within its batch, or -1 when it is not a step
+		int64_t step;
+	};
+
+	std::deque<Entry> queue;
+
+	// when the last event went in, on the schedule
+	uint64_t last;
+};
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include "input.h"
+
+#include <string.h>
+
+#define LOG_MAGIC "NDIN"
+#define LOG_VERSION 1
+
+namespace nodium {
+
+int InputFieldCount(int32_t type)
+{
+	switch(type)
+	{
+	case INPUT_MOUSE_MOVE:
+	case INPUT_MOUSE_WHEEL:
+		return 2;
+	case INPUT_MOUSE_DOWN:
+	case INPUT_MOUSE_UP:
+		return 1;
+	case INPUT_KEY:
+		return INPUT_FIELDS - 2;
+	default:
+		return 0;
+	}
+}
+
+bool ValidInput(const InputEvent& event)
+{
+	if(event.delay < 0)
+		return false;
+
+	switch(event.type)
+	{
+	case INPUT_MOUSE_MOVE:
+	case INPUT_MOUSE_WHEEL:
+		return true;
+	case INPUT_MOUSE_DOWN:
+	case INPUT_MOUSE_UP:
+		return event.fields[0] >= Awesomium::LEFT_MOUSE_BTN &&
+			   event.fields[0] <= Awesomium::RIGHT_MOUSE_BTN;
+	case INPUT_KEY:
+	{
+		int kind = event.fields[0] & ~INPUT_SYSTEM_KEY;
+		return kind >= Awesomium::WebKeyboardEvent::TYPE_KEY_DOWN &&
+			   kind <= Awesomium::WebKeyboardEvent::TYPE_CHAR;
+	}
+	default:
+		return false;
+	}
+}
+
+static void PutVarint(std::string& out, uint32_t value)
+{
+	while(value >= 0x80)
+	{
+		out += (char)(value | 0x80);
+		value >>= 7;
+	}
+
+	out += (char)value;
+}
+
+static bool GetVarint(const unsigned char*& p, const unsigned char* end, uint32_t& value)
+{
+	value = 0;
+
+	for(int shift = 0; shift < 35; shift += 7)
+	{
+		if(p == end)
+			return false;
+
+		unsigned char byte = *p++;
+		value |= (uint32_t)(byte & 0x7F) << shift;
+
+		if(!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+// small negative numbers, say wheel deltas, stay small
+static uint32_t ZigZag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t UnZigZag(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void EncodeInputLog(const std::vector<InputEvent>& events, std::string& out)
+{
+	out += LOG_MAGIC;
+	out += (char)LOG_VERSION;
+
+	for(size_t i = 0; i < events.size(); i++)
+	{
+		const InputEvent& event = events[i];
+
+		PutVarint(out, (uint32_t)event.type);
+		PutVarint(out, (uint32_t)event.delay);
+
+		for(int f = 0; f < InputFieldCount(event.type); f++)
+			PutVarint(out, ZigZag(event.fields[f]));
+	}
+}
+
+bool DecodeInputLog(const char* data, size_t length, std::vector<InputEvent>& out)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + length;
+	size_t start = out.size();
+
+	if(length < 5 || memcmp(data, LOG_MAGIC, 4) != 0 || p[4] != LOG_VERSION)
+		return false;
+
+	p += 5;
+
+	while(p < end)
+	{
+		InputEvent event;
+		uint32_t type, delay, field;
+
+		memset(&event, 0, sizeof(event));
+
+		if(!GetVarint(p, end, type) || !GetVarint(p, end, delay) || delay > 0x7FFFFFFF)
+		{
+			out.resize(start);
+			return false;
+		}
+
+		event.type = (int32_t)type;
+		event.delay = (int32_t)delay;
+
+		for(int f = 0; f < InputFieldCount(event.type); f++)
+		{
+			if(!GetVarint(p, end, field))
+			{
+				out.resize(start);
+				return false;
+			}
+
+			event.fields[f] = UnZigZag(field);
+		}
+
+		if(!ValidInput(event))
+		{
+			out.resize(start);
+			return false;
+		}
+
+		out.push_back(event);
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,134 @@
+#include "jpeg.h"
+#include "pixels.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <vector>
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+// Output grows in steps of this size
+#define JPEG_CHUNK (64 * 1024)
+
+namespace nodium {
+
+// libjpeg reports fatal errors through a callback that must not return;
+// jump back into EncodeJpeg instead of exiting the process
+struct JpegError
+{
+	jpeg_error_mgr base;
+	jmp_buf jump;
+};
+
+static void OnJpegError(j_common_ptr info)
+{
+	longjmp(((JpegError*)info->err)->jump, 1);
+}
+
+// Destination manager appending to a std::string; jpeg_mem_dest is not
+// available in libjpeg 6b
+struct JpegDestination
+{
+	jpeg_destination_mgr base;
+	std::string* out;
+	size_t start;
+};
+
+static void InitDestination(j_compress_ptr info)
+{
+	JpegDestination* dest = (JpegDestination*)info->dest;
+
+	dest->out->resize(dest->start + JPEG_CHUNK);
+	dest->base.next_output_byte = (JOCTET*)&(*dest->out)[dest->start];
+	dest->base.free_in_buffer = JPEG_CHUNK;
+}
+
+static boolean EmptyOutputBuffer(j_compress_ptr info)
+{
+	JpegDestination* dest = (JpegDestination*)info->dest;
+	size_t used = dest->out->size();
+
+	// libjpeg wants the whole buffer flushed regardless of free_in_buffer
+	dest->out->resize(used + JPEG_CHUNK);
+	dest->base.next_output_byte = (JOCTET*)&(*dest->out)[used];
+	dest->base.free_in_buffer = JPEG_CHUNK;
+
+	return TRUE;
+}
+
+static void TermDestination(j_compress_ptr info)
+{
+	JpegDestination* dest = (JpegDestination*)info->dest;
+	dest->out->resize(dest->out->size() - dest->base.free_in_buffer);
+}
+
+bool EncodeJpeg(const unsigned char* bgra, int width, int height, int rowSpan,
+				int quality, std::string& out)
+{
+	jpeg_compress_struct info;
+	JpegError error;
+	JpegDestination dest;
+	std::vector<unsigned char> row;
+
+	size_t start = out.size();
+
+	info.err = jpeg_std_error(&error.base);
+	error.base.error_exit = OnJpegError;
+
+	if(setjmp(error.jump))
+	{
+		jpeg_destroy_compress(&info);
+		out.resize(start);
+		return false;
+	}
+
+	jpeg_create_compress(&info);
+
+	dest.base.init_destination = InitDestination;
+	dest.base.empty_output_buffer = EmptyOutputBuffer;
+	dest.base.term_destination = TermDestination;
+	dest.out = &out;
+	dest.start = start;
+	info.dest = &dest.base;
+
+	info.image_width = width;
+	info.image_height = height;
+
+#if defined(JCS_EXTENSIONS)
+	// libjpeg-turbo converts BGRA itself, with its own SIMD code
+	info.input_components = 4;
+	info.in_color_space = JCS_EXT_BGRA;
+#else
+	info.input_components = 3;
+	info.in_color_space = JCS_RGB;
+	row.resize(width * 3);
+#endif
+
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, quality, TRUE);
+	jpeg_start_compress(&info, TRUE);
+
+	while(info.next_scanline < info.image_height)
+	{
+		const unsigned char* line = bgra + (size_t)info.next_scanline * rowSpan;
+		JSAMPROW rows[1];
+
+#if defined(JCS_EXTENSIONS)
+		rows[0] = (JSAMPROW)line;
+#else
+		BgraToRgb(line, width, &row[0]);
+		rows[0] = &row[0];
+#endif
+
+		jpeg_write_scanlines(&info, rows, 1);
+	}
+
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+
+	return true;
+}
+
+}
@@ -0,0 +1,15 @@
+#ifndef NODIUM_JPEG_H
+#define NODIUM_JPEG_H
+
+#include <string>
+
+namespace nodium {
+
+// Encodes BGRA pixels as a baseline JPEG appended to out, in memory. Safe
+// on worker threads. Returns false, leaving out as it was, on failure.
+bool EncodeJpeg(const unsigned char* bgra, int width, int height, int rowSpan,
+				int quality, std::string& out);
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "jsvalue.h"
+#include "transcode.h"
+
+using namespace v8;
+
+namespace nodium {
+
+Local<Value> FromJSValue(const Awesomium::JSValue& value)
+{
+	HandleScope scope;
+
+	if(value.isBoolean())
+		return scope.Close(Boolean::New(value.toBoolean()));
+
+	if(value.isInteger())
+		return scope.Close(Integer::New(value.toInteger()));
+
+	if(value.isDouble())
+		return scope.Close(Number::New(value.toDouble()));
+
+	if(value.isString())
+		return scope.Close(ToV8(value.toString()));
+
+	if(value.isArray())
+	{
+		const Awesomium::JSValue::Array& array = value.getArray();
+		Local<Array> result = Array::New((int)array.size());
+
+		for(size_t i = 0; i < array.size(); i++)
+			result->Set((uint32_t)i, FromJSValue(array[i]));
+
+		return scope.Close(result);
+	}
+
+	if(value.isObject())
+	{
+		const Awesomium::JSValue::Object& object = value.getObject();
+		Local<Object> result = Object::New();
+
+		for(Awesomium::JSValue::Object::const_iterator it = object.begin();
+			it != object.end(); ++it)
+			result->Set(ToV8(it->first), FromJSValue(it->second));
+
+		return scope.Close(result);
+	}
+
+	if(value.isNull())
+		return scope.Close(Local<Value>::New(Null()));
+
+	return scope.Close(Local<Value>::New(Undefined()));
+}
+
+}
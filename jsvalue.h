@@ -0,0 +1,15 @@
+#ifndef NODIUM_JSVALUE_H
+#define NODIUM_JSVALUE_H
+
+#include <v8.h>
+#include <Awesomium/JSValue.h>
+
+namespace nodium {
+
+// Converts a result returned by the page into the equivalent V8 value,
+// recursing into arrays and objects.
+v8::Local<v8::Value> FromJSValue(const Awesomium::JSValue& value);
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+var fs = require("fs");
+var path = require("path");
+
+// Removes a directory tree synchronously; used at exit, when nothing async
+// gets to run any more
+function removeTree(dir){
+	var entries;
+
+	try {
+		entries = fs.readdirSync(dir);
+	} catch (e){
+		return;
+	}
+
+	entries.forEach(function (name){
+		var file = path.join(dir, name);
+
+		if(fs.lstatSync(file).isDirectory())
+			removeTree(file);
+		else
+			fs.unlinkSync(file);
+	});
+
+	fs.rmdirSync(dir);
+}
+
+// Default for workload.maxSingleViews, the most concurrent views that still
+// share one in-process renderer. A starting point rather than a measured
+// crossover; bench/process.js times a single view in each mode.
+var SINGLE_PROCESS_MAX_VIEWS = 4;
+
+// Picks "single" or "multi" process rendering for a declared workload
+// { trusted, views, maxSingleViews }. Untrusted content always gets child
+// processes, so a renderer crash costs one view ('crashed') rather than
+// the node process. Small trusted workloads run in-process, which saves an
+// IPC round trip on every evaluate() and render(). WebCore only honours
+// forceSingleProcess on Windows, so everywhere else this is "multi".
+function selectProcessModel(workload){
+	workload = workload || {};
+
+	if(!workload.trusted || process.platform !== "win32")
+		return "multi";
+
+	var limit = workload.maxSingleViews !== undefined ? workload.maxSingleViews : SINGLE_PROCESS_MAX_VIEWS;
+
+	return (workload.views || 1) <= limit ? "single" : "multi";
+}
+
+// Applies WebCoreConfig options before the WebCore exists. Besides the
+// native options this understands `tmpfs: true`, which puts the user data
+// and cache directory in a per-process folder under `tmpfsRoot` (default
+// /dev/shm) that is deleted again when the process exits, and `workload`,
+// which sets forceSingleProcess through selectProcessModel().
+exports.init = function (bindings, config){
+	var options = {};
+
+	config = config || {};
+
+	for(var key in config)
+		options[key] = config[key];
+
+	delete options.tmpfs;
+	delete options.tmpfsRoot;
+	delete options.workload;
+
+	// an explicit forceSingleProcess beats the workload profile
+	if(config.workload && config.forceSingleProcess === undefined)
+		options.forceSingleProcess = selectProcessModel(config.workload) === "single";
+
+	if(config.tmpfs){
+		var dir = path.join(config.tmpfsRoot || "/dev/shm", "nodium-" + process.pid);
+
+		// left behind by a crashed process that had our pid; nobody else
+		// can still be using it
+		removeTree(dir);
+		fs.mkdirSync(dir, 448); // 0700
+		options.userDataPath = dir;
+
+		process.on("exit", function (){
+			removeTree(dir);
+		});
+	}
+
+	bindings.init(options);
+
+	return options;
+};
+
+exports.removeTree = removeTree;
+exports.selectProcessModel = selectProcessModel;
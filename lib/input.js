@@ -0,0 +1,93 @@
+// Builds the Int32Array records that view.dispatchInput() takes: eight
+// integers per event, [type, delay, ...fields], as laid out in input.h.
+var FIELDS = 8;
+var SYSTEM_KEY = 0x100;
+
+var TYPES = {
+	mouseMove: 1,
+	mouseDown: 2,
+	mouseUp: 3,
+	mouseWheel: 4,
+	keyDown: 5,
+	keyUp: 5,
+	char: 5
+};
+
+var KEY_KINDS = { keyDown: 0, keyUp: 1, char: 2 };
+var BUTTONS = { left: 0, middle: 1, right: 2 };
+
+// WebKeyboardEvent::Modifiers
+var MODIFIERS = { shift: 1, control: 2, alt: 4, meta: 8, keypad: 16, autoRepeat: 32 };
+
+// Up to two UTF-16 units, the first in the low half
+function packText(text){
+	text = text || "";
+	return (text.charCodeAt(0) || 0) | ((text.charCodeAt(1) || 0) << 16);
+}
+
+function packModifiers(modifiers){
+	var bits = 0;
+
+	(modifiers || []).forEach(function (name){
+		if(!(name in MODIFIERS))
+			throw new Error("Unknown modifier: " + name);
+
+		bits |= MODIFIERS[name];
+	});
+
+	return bits;
+}
+
+// events: [{ type: "mouseMove", x, y }, { type: "mouseDown", button: "left" },
+//          { type: "mouseWheel", vertical, horizontal },
+//          { type: "keyDown" | "keyUp" | "char", keyCode, nativeKeyCode,
+//            modifiers: ["shift"], text, unmodifiedText, system }, ...]
+// Every event may carry delay, the ms to wait after the one before it.
+exports.encode = function (events){
+	var records = new Int32Array(events.length * FIELDS);
+
+	events.forEach(function (event, i){
+		var at = i * FIELDS;
+		var type = TYPES[event.type];
+
+		if(type === undefined)
+			throw new Error("Unknown input event type: " + event.type);
+
+		records[at] = type;
+		records[at + 1] = event.delay || 0;
+
+		switch(event.type){
+		case "mouseMove":
+			records[at + 2] = event.x;
+			records[at + 3] = event.y;
+			break;
+		case "mouseDown":
+		case "mouseUp":
+			records[at + 2] = BUTTONS[event.button || "left"];
+			break;
+		case "mouseWheel":
+			records[at + 2] = event.vertical || 0;
+			records[at + 3] = event.horizontal || 0;
+			break;
+		default:
+			records[at + 2] = KEY_KINDS[event.type] | (event.system ? SYSTEM_KEY : 0);
+			records[at + 3] = packModifiers(event.modifiers);
+			records[at + 4] = event.keyCode || 0;
+			records[at + 5] = event.nativeKeyCode || 0;
+			records[at + 6] = packText(event.text);
+			records[at + 7] = packText(event.unmodifiedText !== undefined ?
+			                           event.unmodifiedText : event.text);
+		}
+	});
+
+	return records;
+};
+
+// Move, press and release: the events of a left click at x, y
+exports.click = function (x, y, delay){
+	return [
+		{ type: "mouseMove", x: x, y: y, delay: delay || 0 },
+		{ type: "mouseDown", button: "left" },
+		{ type: "mouseUp", button: "left" }
+	];
+};
@@ -0,0 +1,209 @@
+var util = require("util");
+var EventEmitter = require("events").EventEmitter;
+
+// Runs page jobs on their own WebView behind admission control. Like
+// stream.write(), submit() returns false when the caller should back off and
+// the queue emits 'drain' once it has room again. Limits are process-wide:
+// they guard the host, not an individual queue.
+function JobQueue(bindings, options){
+	EventEmitter.call(this);
+
+	options = options || {};
+
+	this.bindings = bindings;
+	this.policy = options.policy || "delay"; // or "reject"
+	this.mode = options.mode || "render"; // or "extract"
+	this.retryInterval = options.retryInterval || 100;
+	this.timeout = options.timeout || 30000;
+	this.width = options.width || 512;
+	this.height = options.height || 512;
+	this.trace = !!options.trace;
+	this.userScripts = options.userScripts || [];
+	this.headerProfile = options.headerProfile || null;
+	this.block = options.block || null;
+
+	this.waiting = [];
+	this.running = 0;
+	this.saturated = false;
+	this.retryTimer = null;
+
+	// only the limits this queue was given; a queue created with defaults
+	// must not lift the ones another queue set for the whole process
+	var limits = {};
+
+	["maxViews", "maxQueued", "maxRss"].forEach(function (name){
+		if(options[name] !== undefined)
+			limits[name] = options[name];
+	});
+
+	bindings.setAdmissionLimits(limits);
+}
+
+util.inherits(JobQueue, EventEmitter);
+
+exports.JobQueue = JobQueue;
+
+function backpressure(reason){
+	var err = new Error("Job rejected: " + reason + " limit reached");
+	err.code = "EBACKPRESSURE";
+	err.reason = reason;
+	return err;
+}
+
+// job: { url | html, mode, cookies, width, height, timeout, trace,
+//        userScripts, headerProfile, block, run: function (view, done) }
+JobQueue.prototype.submit = function (job, callback){
+	var entry = { job: job, callback: callback || function (){} };
+
+	if(this.waiting.length === 0 && this.bindings.admission(0).verdict === "ok"){
+		this._start(entry);
+		return true;
+	}
+
+	var state = this.bindings.admission(this.waiting.length);
+
+	if(state.verdict === "queue" || this.policy === "reject"){
+		var reason = state.verdict === "ok" ? "queue" : state.verdict;
+		this.emit("pressure", reason, state);
+		process.nextTick(function (){
+			entry.callback(backpressure(reason));
+		});
+		return false;
+	}
+
+	this.waiting.push(entry);
+
+	if(!this.saturated){
+		this.saturated = true;
+		this.emit("pressure", state.verdict, state);
+	}
+
+	this._schedule();
+	return false;
+};
+
+JobQueue.prototype.stats = function (){
+	var state = this.bindings.admission(this.waiting.length);
+	state.running = this.running;
+	return state;
+};
+
+JobQueue.prototype._pump = function (){
+	while(this.waiting.length > 0){
+		if(this.bindings.admission(0).verdict !== "ok"){
+			// memory pressure never announces its end; poll for it
+			this._schedule();
+			return;
+		}
+
+		this._start(this.waiting.shift());
+	}
+
+	if(this.saturated){
+		this.saturated = false;
+		this.emit("drain");
+	}
+};
+
+JobQueue.prototype._schedule = function (){
+	var self = this;
+
+	if(this.retryTimer)
+		return;
+
+	this.retryTimer = setTimeout(function (){
+		self.retryTimer = null;
+		self._pump();
+	}, this.retryInterval);
+};
+
+JobQueue.prototype._start = function (entry){
+	var self = this;
+	var job = entry.job;
+	var view, finished = false;
+
+	// extraction jobs never paint and get a minimal viewport unless the job
+	// asks for one
+	if((job.mode || this.mode) === "extract")
+		view = new this.bindings.WebView(job.width, job.height, { paint: false });
+	else
+		view = new this.bindings.WebView(job.width || this.width, job.height || this.height);
+
+	this.running++;
+
+	// one Chrome trace per job, handed out through the 'trace' event
+	var tracing = job.trace !== undefined ? job.trace : this.trace;
+
+	if(tracing)
+		view.startTrace();
+
+	function finish(err, result){
+		if(finished)
+			return;
+
+		finished = true;
+		clearTimeout(timer);
+
+		if(tracing)
+			self.emit("trace", view.stopTrace(), job);
+
+		// what the page logged is usually the best clue to why it failed
+		if(err && typeof err === "object" && view.drainConsole)
+			err.console = view.drainConsole();
+
+		view.destroy();
+		self.running--;
+		entry.callback(err, result);
+		self._pump();
+	}
+
+	var timer = setTimeout(function (){
+		var err = new Error("Job timed out");
+		err.code = "ETIMEDOUT";
+		finish(err);
+	}, job.timeout || this.timeout);
+
+	view.on("crashed", function (){
+		var err = new Error("WebView crashed");
+		err.code = "ECRASHED";
+		finish(err);
+	});
+
+	view.once("finishLoading", function (){
+		if(finished)
+			return;
+
+		if(job.run)
+			job.run(view, finish);
+		else
+			finish(null);
+	});
+
+	// the queue's scripts and styles first, then the job's own
+	var scripts = this.userScripts.concat(job.userScripts || []);
+	var profile = job.headerProfile !== undefined ? job.headerProfile : this.headerProfile;
+	var block = job.block !== undefined ? job.block : this.block;
+
+	try {
+		if(scripts.length > 0)
+			view.setUserScripts(scripts);
+
+		if(profile)
+			view.setHeaderProfile(profile);
+
+		if(block)
+			view.setBlocking(block);
+	} catch(err){
+		finish(err);
+		return;
+	}
+
+	// a jar from exportCookies() restores a logged-in session up front
+	if(job.cookies)
+		this.bindings.importCookies(job.cookies);
+
+	if(job.html !== undefined)
+		view.loadHTML(job.html);
+	else
+		view.loadURL(job.url);
+};
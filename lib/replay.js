@@ -0,0 +1,84 @@
+// Replays a recorded input log (view.stopRecording()) against a pool of
+// fresh views in parallel. Every view loads the same page and gets the same
+// log once the page has finished loading, so each session starts from the
+// same state and sees the same events at the same offsets.
+//
+// options: { views: 4, url, width, height, speed: 1 (0 for no delays),
+//            timeout: 30000, step: function (view, index, session){} }
+//
+// step, if given, runs after every event, with the page as that event
+// left it, e.g. to take a screenshot. callback(err, report) gets
+// { views, events, elapsed, sessions: [ms], eventsPerSecond }.
+exports.replay = function (bindings, log, options, callback){
+	var count = options.views || 4;
+	var speed = options.speed === undefined ? 1 : options.speed;
+	var timeout = options.timeout || 30000;
+	var sessions = [];
+	var events = 0;
+	var pending = count;
+	var failed = null;
+	var start = Date.now();
+
+	function finish(err){
+		if(err && !failed)
+			failed = err;
+
+		if(--pending > 0)
+			return;
+
+		if(failed)
+			return callback(failed);
+
+		var elapsed = Date.now() - start;
+
+		callback(null, {
+			views: count,
+			events: events,
+			elapsed: elapsed,
+			sessions: sessions,
+			eventsPerSecond: elapsed ? events * count * 1000 / elapsed : 0
+		});
+	}
+
+	function session(index){
+		var view = new bindings.WebView(options.width || 1024, options.height || 768);
+		var timer = setTimeout(function (){ done(new Error("Replay timed out")); }, timeout);
+		var began;
+
+		function done(err){
+			clearTimeout(timer);
+			view.removeAllListeners();
+			view.destroy();
+			finish(err);
+		}
+
+		view.once("finishLoading", function (){
+			began = Date.now();
+			events = view.dispatchInput(log, { speed: speed, steps: !!options.step });
+
+			// an empty log never reaches inputDone
+			if(events === 0){
+				sessions[index] = 0;
+				done(null);
+			}
+		});
+
+		view.on("inputStep", function (step){
+			options.step(view, step, index);
+		});
+
+		view.once("inputDone", function (){
+			sessions[index] = Date.now() - began;
+			done(null);
+		});
+
+		view.once("crashed", function (){
+			done(new Error("WebView crashed during replay"));
+		});
+
+		view.loadURL(options.url);
+	}
+
+	for(var i = 0; i < count; i++)
+		session(i);
+};
@@ -0,0 +1,86 @@
+// view.route(pattern, handler, [options]) on top of the native addRoute(),
+// removeRoute() and answerRoute().
+//
+// handler is a Buffer or string, served natively without calling into JS,
+// or function (request, respond) with request { url, method }. It either
+// returns the body or calls respond(err, body, [mimeType]) later. The
+// request waits inside Awesomium until it is answered or options.timeout
+// (default 10000 ms) passes; errors and timeouts cancel it. A handler that
+// throws is reported as 'error' on the view, when anything listens for
+// it. MIME types come from respond(), options.mimeType or the URL's
+// extension.
+var DEFAULT_TIMEOUT = 10000;
+
+function dispatch(view, seq, id, url, method){
+	var handler = view._routeHandlers[id];
+	var answered = false;
+
+	function respond(err, body, mimeType){
+		if(answered)
+			return;
+
+		answered = true;
+
+		if(typeof body === "string")
+			body = new Buffer(body);
+
+		view.answerRoute(seq, err ? null : body, mimeType || "");
+	}
+
+	if(!handler)
+		return respond(new Error("Route was removed"));
+
+	try {
+		var result = handler({ url: url, method: method }, respond);
+
+		if(result !== undefined)
+			respond(null, result);
+	} catch(err){
+		respond(err);
+
+		// called from the event loop with nobody up the stack to catch it
+		if(view.listeners("error").length > 0)
+			view.emit("error", err);
+	}
+}
+
+exports.route = function (view, pattern, handler, options){
+	options = options || {};
+
+	var mimeType = options.mimeType || "";
+
+	if(typeof handler === "string")
+		handler = new Buffer(handler);
+
+	if(typeof handler !== "function"){
+		view.addRoute(pattern, handler, mimeType);
+		return;
+	}
+
+	if(!view._routeHandlers){
+		view._routeHandlers = {};
+		view._routeIds = {};
+		view._nextRoute = 1;
+
+		view.on("route", function (seq, id, url, method){
+			dispatch(view, seq, id, url, method);
+		});
+	}
+
+	var id = view._nextRoute++;
+
+	view.addRoute(pattern, id, mimeType, options.timeout || DEFAULT_TIMEOUT);
+
+	delete view._routeHandlers[view._routeIds[pattern]];
+	view._routeHandlers[id] = handler;
+	view._routeIds[pattern] = id;
+};
+
+exports.unroute = function (view, pattern){
+	if(view._routeIds){
+		delete view._routeHandlers[view._routeIds[pattern]];
+		delete view._routeIds[pattern];
+	}
+
+	return view.removeRoute(pattern);
+};
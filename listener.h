@@ -0,0 +1,57 @@
+#ifndef NODIUM_LISTENER_H
+#define NODIUM_LISTENER_H
+
+#include <Awesomium/WebCore.h>
+
+namespace nodium {
+
+// WebViewListener that ignores everything, for native-only views that care
+// about a couple of callbacks and would otherwise stub out the rest
+class NullListener : public Awesomium::WebViewListener
+{
+public:
+	virtual ~NullListener() {}
+
+	void onBeginNavigation(Awesomium::WebView* caller, const std::string& url,
+						   const std::wstring& frameName) {}
+	void onBeginLoading(Awesomium::WebView* caller, const std::string& url,
+						const std::wstring& frameName, int statusCode,
+						const std::wstring& mimeType) {}
+	void onFinishLoading(Awesomium::WebView* caller) {}
+	void onCallback(Awesomium::WebView* caller, const std::wstring& objectName,
+					const std::wstring& callbackName,
+					const Awesomium::JSArguments& args) {}
+	void onReceiveTitle(Awesomium::WebView* caller, const std::wstring& title,
+						const std::wstring& frameName) {}
+	void onChangeTooltip(Awesomium::WebView* caller, const std::wstring& tooltip) {}
+	void onChangeCursor(Awesomium::WebView* caller, Awesomium::CursorType cursor) {}
+	void onChangeKeyboardFocus(Awesomium::WebView* caller, bool isFocused) {}
+	void onChangeTargetURL(Awesomium::WebView* caller, const std::string& url) {}
+	void onOpenExternalLink(Awesomium::WebView* caller, const std::string& url,
+							const std::wstring& source) {}
+	void onRequestDownload(Awesomium::WebView* caller, const std::string& url) {}
+	void onWebViewCrashed(Awesomium::WebView* caller) {}
+	void onPluginCrashed(Awesomium::WebView* caller, const std::wstring& pluginName) {}
+	void onRequestMove(Awesomium::WebView* caller, int x, int y) {}
+	void onGetPageContents(Awesomium::WebView* caller, const std::string& url,
+						   const std::wstring& contents) {}
+	void onDOMReady(Awesomium::WebView* caller) {}
+	void onRequestFileChooser(Awesomium::WebView* caller, bool selectMultipleFiles,
+							  const std::wstring& title,
+							  const std::wstring& defaultPath) {}
+	void onGetScrollData(Awesomium::WebView* caller, int contentWidth,
+						 int contentHeight, int preferredWidth, int scrollX,
+						 int scrollY) {}
+	void onJavascriptConsoleMessage(Awesomium::WebView* caller,
+									const std::wstring& message, int lineNumber,
+									const std::wstring& source) {}
+	void onGetFindResults(Awesomium::WebView* caller, int requestID,
+						  int numMatches, const Awesomium::Rect& selection,
+						  int curMatch, bool finalUpdate) {}
+	void onUpdateIME(Awesomium::WebView* caller, Awesomium::IMEState imeState,
+					 const Awesomium::Rect& caretRect) {}
+};
+
+}
+
+#endif
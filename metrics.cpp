@@ -0,0 +1,294 @@
+#include "metrics.h"
+#include "core.h"
+#include "admission.h"
+#include "pool.h"
+
+#include <node.h>
+#include <uv.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace v8;
+
+namespace nodium {
+
+uint64_t Metrics::counters[COUNTER_COUNT];
+Histogram Metrics::histograms[LATENCY_COUNT];
+
+static const struct { const char* key; const char* name; const char* help; } counterInfo[] = {
+	{ "viewsCreated", "nodium_views_created_total", "WebViews created" },
+	{ "viewsDestroyed", "nodium_views_destroyed_total", "WebViews destroyed" },
+	{ "loadsStarted", "nodium_loads_started_total", "Main-frame navigations started" },
+	{ "loadsFinished", "nodium_loads_finished_total", "Page loads finished" },
+	{ "loadsFailed", "nodium_loads_failed_total", "Main-frame responses with an HTTP error status" },
+	{ "loadsCrashed", "nodium_loads_crashed_total", "WebView renderer crashes" },
+	{ "interceptorHits", "nodium_interceptor_requests_total", "Requests seen by the resource interceptor" },
+	{ "interceptorBytes", "nodium_interceptor_bytes_total", "Expected response bytes seen by the resource interceptor" },
+	{ "blockedRequests", "nodium_blocked_requests_total", "Requests stopped by a blocking policy" },
+	{ "routedRequests", "nodium_routed_requests_total", "Requests answered by view.route()" },
+	{ "routedBytes", "nodium_routed_bytes_total", "Response bytes served by view.route()" },
+	{ "routedFailures", "nodium_routed_failures_total", "Routed requests cancelled after a handler error or timeout" }
+};
+
+static const struct { const char* key; const char* name; const char* help; } latencyInfo[] = {
+	{ "updateTick", "nodium_update_tick_seconds", "WebCore update() plus event delivery" },
+	{ "jsEval", "nodium_js_eval_seconds", "evaluate() round trip" },
+	{ "render", "nodium_render_seconds", "WebView render()" },
+	{ "encode", "nodium_encode_seconds", "Image encoding" }
+};
+
+size_t Histogram::Bucket(uint64_t value)
+{
+	if(value < SUB_COUNT)
+		return (size_t)value;
+
+	int exponent = 63 - __builtin_clzll(value);
+
+	if(exponent >= MAX_EXPONENT)
+		return BUCKETS - 1;
+
+	return (exponent - SUB_BITS + 1) * SUB_COUNT +
+		   (size_t)((value >> (exponent - SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+uint64_t Histogram::BucketLow(size_t bucket)
+{
+	if(bucket < SUB_COUNT)
+		return bucket;
+
+	int exponent = (int)(bucket / SUB_COUNT) + SUB_BITS - 1;
+	uint64_t sub = bucket % SUB_COUNT;
+
+	return (SUB_COUNT + sub) << (exponent - SUB_BITS);
+}
+
+uint64_t Histogram::BucketHigh(size_t bucket)
+{
+	if(bucket < SUB_COUNT)
+		return bucket;
+
+	int exponent = (int)(bucket / SUB_COUNT) + SUB_BITS - 1;
+
+	return BucketLow(bucket) + (1ULL << (exponent - SUB_BITS)) - 1;
+}
+
+void Histogram::Record(uint64_t value)
+{
+	__sync_fetch_and_add(&buckets[Bucket(value)], 1);
+	__sync_fetch_and_add(&count, 1);
+	__sync_fetch_and_add(&sum, value);
+
+	uint64_t seen = max;
+
+	while(value > seen)
+	{
+		uint64_t prior = __sync_val_compare_and_swap(&max, seen, value);
+
+		if(prior == seen)
+			break;
+
+		seen = prior;
+	}
+}
+
+void Histogram::Snapshot(Histogram& out) const
+{
+	memcpy(out.buckets, buckets, sizeof(buckets));
+	out.max = max;
+	out.sum = sum;
+
+	// derive the count from the copied buckets so quantiles add up
+	out.count = 0;
+
+	for(size_t i = 0; i < BUCKETS; i++)
+		out.count += out.buckets[i];
+}
+
+uint64_t Histogram::Quantile(double q) const
+{
+	if(count == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(q * count + 0.5);
+	uint64_t seen = 0;
+
+	if(rank == 0)
+		rank = 1;
+
+	for(size_t i = 0; i < BUCKETS; i++)
+	{
+		seen += buckets[i];
+
+		if(seen >= rank)
+			return BucketHigh(i) < max ? BucketHigh(i) : max;
+	}
+
+	return max;
+}
+
+ScopedLatency::ScopedLatency(Latency latency)
+	: latency(latency), start(uv_hrtime())
+{
+}
+
+ScopedLatency::~ScopedLatency()
+{
+	Metrics::Record(latency, (uv_hrtime() - start) / 1000);
+}
+
+void Metrics::Init(Handle<Object> target)
+{
+	NODE_SET_METHOD(target, "stats", Stats);
+	NODE_SET_METHOD(target, "metrics", Prometheus);
+}
+
+static void Append(std::string& out, const char* format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+static void Append(std::string& out, const char* format, ...)
+{
+	char line[256];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+
+	out += line;
+}
+
+void Metrics::Dump(std::string& out)
+{
+	for(int i = 0; i < COUNTER_COUNT; i++)
+	{
+		Append(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+			   counterInfo[i].name, counterInfo[i].help, counterInfo[i].name,
+			   counterInfo[i].name, (unsigned long long)counters[i]);
+	}
+
+	Append(out, "# HELP nodium_views Live WebViews\n# TYPE nodium_views gauge\nnodium_views %lu\n",
+		   (unsigned long)Core::ViewCount());
+	Append(out, "# HELP nodium_rss_bytes Resident memory of this process and its renderers\n"
+		   "# TYPE nodium_rss_bytes gauge\nnodium_rss_bytes %lu\n",
+		   (unsigned long)Admission::Rss());
+
+	PixelPool::Stats pool;
+	PixelPool::GetStats(pool);
+
+	Append(out, "# HELP nodium_pixel_pool_bytes Pixel pool memory by state\n"
+		   "# TYPE nodium_pixel_pool_bytes gauge\n"
+		   "nodium_pixel_pool_bytes{state=\"in_use\"} %llu\n"
+		   "nodium_pixel_pool_bytes{state=\"pooled\"} %llu\n",
+		   (unsigned long long)pool.inUse, (unsigned long long)pool.pooled);
+	Append(out, "# HELP nodium_pixel_pool_high_water_bytes Most memory the pixel pool has held\n"
+		   "# TYPE nodium_pixel_pool_high_water_bytes gauge\n"
+		   "nodium_pixel_pool_high_water_bytes %llu\n", (unsigned long long)pool.highWater);
+	Append(out, "# HELP nodium_pixel_pool_requests_total Pixel pool requests by outcome\n"
+		   "# TYPE nodium_pixel_pool_requests_total counter\n"
+		   "nodium_pixel_pool_requests_total{result=\"hit\"} %llu\n"
+		   "nodium_pixel_pool_requests_total{result=\"miss\"} %llu\n",
+		   (unsigned long long)pool.hits, (unsigned long long)pool.misses);
+
+	Histogram snapshot;
+
+	for(int i = 0; i < LATENCY_COUNT; i++)
+	{
+		const char* name = latencyInfo[i].name;
+		histograms[i].Snapshot(snapshot);
+
+		Append(out, "# HELP %s %s\n# TYPE %s histogram\n", name, latencyInfo[i].help, name);
+
+		// One cumulative bucket per power of two, the same ladder on every
+		// scrape. le is inclusive, so each bound is the last whole
+		// microsecond below the power of two. The top bucket also holds
+		// everything clamped into it and is left to +Inf.
+		uint64_t cumulative = 0;
+		size_t bucket = 0;
+
+		for(int exponent = Histogram::SUB_BITS; exponent < Histogram::MAX_EXPONENT; exponent++)
+		{
+			uint64_t bound = (1ULL << exponent) - 1;
+
+			for(; bucket < Histogram::BUCKETS && Histogram::BucketHigh(bucket) <= bound; bucket++)
+				cumulative += snapshot.buckets[bucket];
+
+			Append(out, "%s_bucket{le=\"%.6f\"} %llu\n", name, bound / 1e6,
+				   (unsigned long long)cumulative);
+		}
+
+		Append(out, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %g\n%s_count %llu\n",
+			   name, (unsigned long long)snapshot.count, name, snapshot.sum / 1e6,
+			   name, (unsigned long long)snapshot.count);
+	}
+}
+
+Handle<Value> Metrics::Stats(const Arguments& args)
+{
+	HandleScope scope;
+
+	Local<Object> result = Object::New();
+	Local<Object> counts = Object::New();
+	Local<Object> gauges = Object::New();
+	Local<Object> latency = Object::New();
+
+	for(int i = 0; i < COUNTER_COUNT; i++)
+		counts->Set(String::NewSymbol(counterInfo[i].key), Number::New((double)counters[i]));
+
+	gauges->Set(String::NewSymbol("views"), Integer::NewFromUnsigned(Core::ViewCount()));
+	gauges->Set(String::NewSymbol("rss"), Number::New((double)Admission::Rss()));
+
+	static const struct { const char* key; double q; } quantiles[] = {
+		{ "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 }, { "p999", 0.999 }
+	};
+
+	Histogram snapshot;
+
+	for(int i = 0; i < LATENCY_COUNT; i++)
+	{
+		histograms[i].Snapshot(snapshot);
+
+		Local<Object> summary = Object::New();
+		summary->Set(String::NewSymbol("count"), Number::New((double)snapshot.count));
+		summary->Set(String::NewSymbol("mean"), Number::New(
+			snapshot.count ? (double)snapshot.sum / snapshot.count : 0));
+		summary->Set(String::NewSymbol("max"), Number::New((double)snapshot.max));
+
+		for(size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+			summary->Set(String::NewSymbol(quantiles[q].key),
+						 Number::New((double)snapshot.Quantile(quantiles[q].q)));
+
+		latency->Set(String::NewSymbol(latencyInfo[i].key), summary);
+	}
+
+	PixelPool::Stats stats;
+	PixelPool::GetStats(stats);
+
+	Local<Object> pool = Object::New();
+	pool->Set(String::NewSymbol("inUse"), Number::New((double)stats.inUse));
+	pool->Set(String::NewSymbol("inUseBlocks"), Number::New((double)stats.inUseBlocks));
+	pool->Set(String::NewSymbol("pooled"), Number::New((double)stats.pooled));
+	pool->Set(String::NewSymbol("pooledBlocks"), Number::New((double)stats.pooledBlocks));
+	pool->Set(String::NewSymbol("highWater"), Number::New((double)stats.highWater));
+	pool->Set(String::NewSymbol("hits"), Number::New((double)stats.hits));
+	pool->Set(String::NewSymbol("misses"), Number::New((double)stats.misses));
+
+	result->Set(String::NewSymbol("counters"), counts);
+	result->Set(String::NewSymbol("gauges"), gauges);
+	result->Set(String::NewSymbol("latency"), latency);
+	result->Set(String::NewSymbol("pixelPool"), pool);
+
+	return scope.Close(result);
+}
+
+Handle<Value> Metrics::Prometheus(const Arguments& args)
+{
+	HandleScope scope;
+
+	std::string out;
+	Dump(out);
+
+	return scope.Close(String::New(out.data(), (int)out.size()));
+}
+
+}
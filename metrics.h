@@ -0,0 +1,108 @@
+#ifndef NODIUM_METRICS_H
+#define NODIUM_METRICS_H
+
+#include <v8.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace nodium {
+
+enum Counter
+{
+	VIEWS_CREATED = 0,
+	VIEWS_DESTROYED,
+	LOADS_STARTED,
+	LOADS_FINISHED,
+	LOADS_FAILED,
+	LOADS_CRASHED,
+	INTERCEPTOR_HITS,
+	INTERCEPTOR_BYTES,
+	BLOCKED_REQUESTS,
+	ROUTED_REQUESTS,
+	ROUTED_BYTES,
+	ROUTED_FAILURES,
+	COUNTER_COUNT
+};
+
+enum Latency
+{
+	UPDATE_TICK = 0,
+	JS_EVAL,
+	RENDER,
+	ENCODE,
+	LATENCY_COUNT
+};
+
+// Log-linear histogram in the style of HdrHistogram: values below
+// 2^SUB_BITS get a bucket each, every power of two above that is split
+// into 2^SUB_BITS buckets, so any recorded value is known to within ~6%.
+// Recording is a handful of atomic adds and safe from any thread.
+class Histogram
+{
+public:
+	enum { SUB_BITS = 4, SUB_COUNT = 1 << SUB_BITS, MAX_EXPONENT = 40 };
+	enum { BUCKETS = (MAX_EXPONENT - SUB_BITS + 1) * SUB_COUNT };
+
+	void Record(uint64_t value);
+
+	// Consistent enough copy for reporting; writers are not stopped
+	void Snapshot(Histogram& out) const;
+
+	// Upper end of the bucket holding the given quantile (0..1)
+	uint64_t Quantile(double q) const;
+
+	static size_t Bucket(uint64_t value);
+	static uint64_t BucketLow(size_t bucket);
+	static uint64_t BucketHigh(size_t bucket);
+
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t buckets[BUCKETS];
+};
+
+// Process-wide counters and latency histograms (in microseconds). They are
+// always on: recording costs a few uncontended atomic adds, and nothing is
+// aggregated until stats() or metrics() is called from JS.
+class Metrics
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+	static void Count(Counter counter, uint64_t amount = 1)
+	{
+		__sync_fetch_and_add(&counters[counter], amount);
+	}
+
+	static void Record(Latency latency, uint64_t micros)
+	{
+		histograms[latency].Record(micros);
+	}
+
+	// Prometheus text exposition format
+	static void Dump(std::string& out);
+
+private:
+	static v8::Handle<v8::Value> Stats(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Prometheus(const v8::Arguments& args);
+
+	static uint64_t counters[COUNTER_COUNT];
+	static Histogram histograms[LATENCY_COUNT];
+};
+
+// Records the lifetime of the enclosing scope into a latency histogram
+class ScopedLatency
+{
+public:
+	explicit ScopedLatency(Latency latency);
+	~ScopedLatency();
+
+private:
+	Latency latency;
+	uint64_t start;
+};
+
+}
+
+#endif
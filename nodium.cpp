@@ -6,6 +6,16 @@
 #include <Awesomium/WebCore.h>
 #include <iostream>
 
+// Headers for the bindings
+#include "core.h"
+#include "view.h"
+#include "admission.h"
+#include "cookies.h"
+#include "metrics.h"
+#include "batch.h"
+#include "userscripts.h"
+#include "headers.h"
+
 #if defined(__WIN32__) || defined(_WIN32)
   #include <windows.h>
   #define sleep(x) Sleep(x)
@@ -26,8 +36,8 @@ using namespace v8;
 // hello world program for awesomium as node module
 static int hw()
 {
-	// create webcore singleton with the default options
-	Awesomium::WebCore* webCore = new Awesomium::WebCore();
+	// share the webcore singleton with the WebView bindings
+	Awesomium::WebCore* webCore = nodium::Core::Get();
 	
 	// create webview singleton at width x height resolution
 	Awesomium::WebView* webView = webCore->createWebView(WIDTH, HEIGHT);
@@ -59,9 +69,6 @@ static int hw()
 	// destroy webview instance
 	webView->destroy();
 	
-	// destroy webcore instance
-	delete webCore;
-	
 	return 0;
 }
 
@@ -75,6 +82,15 @@ extern "C" {
 static void init(Handle<Object> target)
 {
 	NODE_SET_METHOD(target, "hello", hello);
+
+	nodium::Core::Init(target);
+	nodium::View::Init(target);
+	nodium::Admission::Init(target);
+	nodium::CookieJar::Init(target);
+	nodium::Metrics::Init(target);
+	nodium::CaptureBatch::Init(target);
+	nodium::UserScripts::Init(target);
+	nodium::HeaderProfiles::Init(target);
 }
 
 	NODE_MODULE(nodium, init);
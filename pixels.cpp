@@ -0,0 +1,137 @@
+#include "pixels.h"
+
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+namespace nodium {
+
+void BgraToRgb(const unsigned char* src, size_t width, unsigned char* dest)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128i green = _mm_set1_epi32(0x0000FF00);
+	const __m128i low = _mm_set1_epi32(0x000000FF);
+	const __m128i first = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+	const __m128i second = _mm_set_epi32(0x0000FFFF, (int)0xFF000000, 0x0000FFFF, (int)0xFF000000);
+
+	// Four pixels per round: swap red and blue in each 32-bit lane, then
+	// squeeze each pair of pixels into the low six bytes of its 64-bit
+	// lane. The two 8-byte stores overlap and run two bytes past the
+	// twelve that are kept, so stop while at least one more pixel follows.
+	while(i + 5 <= width)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+
+		__m128i rgb = _mm_or_si128(_mm_and_si128(v, green),
+								   _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), low),
+												_mm_slli_epi32(_mm_and_si128(v, low), 16)));
+
+		__m128i packed = _mm_or_si128(_mm_and_si128(rgb, first),
+									  _mm_and_si128(_mm_srli_epi64(rgb, 8), second));
+
+		_mm_storel_epi64((__m128i*)(dest + i * 3), packed);
+		_mm_storel_epi64((__m128i*)(dest + i * 3 + 6), _mm_srli_si128(packed, 8));
+
+		i += 4;
+	}
+#endif
+
+	for(; i < width; i++)
+	{
+		dest[i * 3] = src[i * 4 + 2];
+		dest[i * 3 + 1] = src[i * 4 + 1];
+		dest[i * 3 + 2] = src[i * 4];
+	}
+}
+
+// Rec. 601 luma weights in 1/256ths: blue, green, red
+#define LUMA_B 29
+#define LUMA_G 150
+#define LUMA_R 77
+
+// 16 pixels per block, 256ths per weight
+#define LUMA_SHIFT 12
+
+void BlockLuma(const unsigned char* src, size_t rowSpan, size_t blocks, unsigned char* dest)
+{
+	size_t b = 0;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i weights = _mm_set_epi16(0, LUMA_R, LUMA_G, LUMA_B, 0, LUMA_R, LUMA_G, LUMA_B);
+
+	// one block per round: widen its four rows of four pixels, fold them
+	// into per-channel sums and weight those into luma
+	for(; b < blocks; b++)
+	{
+		const unsigned char* p = src + b * LUMA_BLOCK * 4;
+		__m128i lo = zero;
+		__m128i hi = zero;
+
+		for(int y = 0; y < LUMA_BLOCK; y++)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(p + y * rowSpan));
+			lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+			hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+		}
+
+		__m128i sums = _mm_add_epi16(lo, hi);
+		sums = _mm_add_epi16(sums, _mm_srli_si128(sums, 8));
+
+		__m128i weighted = _mm_madd_epi16(sums, weights);
+		weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 4));
+
+		dest[b] = (unsigned char)(_mm_cvtsi128_si32(weighted) >> LUMA_SHIFT);
+	}
+#endif
+
+	for(; b < blocks; b++)
+	{
+		unsigned sum[3] = { 0, 0, 0 };
+
+		for(int y = 0; y < LUMA_BLOCK; y++)
+		{
+			const unsigned char* p = src + y * rowSpan + b * LUMA_BLOCK * 4;
+
+			for(int x = 0; x < LUMA_BLOCK; x++)
+			{
+				sum[0] += p[x * 4];
+				sum[1] += p[x * 4 + 1];
+				sum[2] += p[x * 4 + 2];
+			}
+		}
+
+		dest[b] = (unsigned char)((sum[0] * LUMA_B + sum[1] * LUMA_G + sum[2] * LUMA_R) >> LUMA_SHIFT);
+	}
+}
+
+uint64_t SumAbsDiff(const unsigned char* a, const unsigned char* b, size_t length)
+{
+	uint64_t total = 0;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	__m128i sum = _mm_setzero_si128();
+
+	// psadbw leaves two 16-bit partial sums, one per 64-bit half, which
+	// cannot overflow 64-bit lanes for any buffer that fits in memory
+	for(; i + 16 <= length; i += 16)
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + i)),
+											   _mm_loadu_si128((const __m128i*)(b + i))));
+
+	uint64_t halves[2];
+	_mm_storeu_si128((__m128i*)halves, sum);
+	total = halves[0] + halves[1];
+#endif
+
+	for(; i < length; i++)
+		total += abs((int)a[i] - (int)b[i]);
+
+	return total;
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef NODIUM_PIXELS_H
+#define NODIUM_PIXELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nodium {
+
+// Pixel kernels for the capture path. Awesomium renders BGRA; they know
+// nothing about V8 and are safe to run on worker threads.
+
+// Converts one row of width BGRA pixels to packed RGB (3 * width bytes),
+// dropping alpha
+void BgraToRgb(const unsigned char* src, size_t width, unsigned char* dest);
+
+// Side of the square blocks BlockLuma averages over
+#define LUMA_BLOCK 4
+
+// Reduces LUMA_BLOCK rows of BGRA, rowSpan bytes apart, to one byte of
+// luma per LUMA_BLOCK x LUMA_BLOCK block, for blocks whole blocks
+void BlockLuma(const unsigned char* src, size_t rowSpan, size_t blocks, unsigned char* dest);
+
+// Sum of absolute differences between two byte runs
+uint64_t SumAbsDiff(const unsigned char* a, const unsigned char* b, size_t length);
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <map>
+#include <vector>
+
+// Free blocks kept for reuse unless init() says otherwise
+#define DEFAULT_RETAIN_BYTES (256 * 1024 * 1024)
+
+// Nothing smaller than this is worth its own class
+#define MIN_CLASS_BYTES 4096
+
+namespace nodium {
+
+// Sits in the ALIGNMENT bytes in front of every block, keeping the block
+// itself aligned
+struct BlockHeader
+{
+	size_t capacity;
+};
+
+typedef std::map<size_t, std::vector<BlockHeader*> > FreeLists;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static FreeLists freeLists;
+static size_t retain = DEFAULT_RETAIN_BYTES;
+static PixelPool::Stats stats;
+
+// Rounds up to the next of the four classes in size's octave
+static size_t ClassSize(size_t size)
+{
+	if(size <= MIN_CLASS_BYTES)
+		return MIN_CLASS_BYTES;
+
+	int exponent = 63 - __builtin_clzll((unsigned long long)(size - 1));
+	size_t step = (size_t)1 << (exponent - 2);
+
+	return (size + step - 1) & ~(step - 1);
+}
+
+static BlockHeader* HeaderOf(const unsigned char* block)
+{
+	return (BlockHeader*)(block - PixelPool::ALIGNMENT);
+}
+
+unsigned char* PixelPool::Acquire(size_t size)
+{
+	size_t capacity = ClassSize(size);
+	BlockHeader* header = NULL;
+
+	pthread_mutex_lock(&lock);
+
+	FreeLists::iterator it = freeLists.find(capacity);
+
+	if(it != freeLists.end() && !it->second.empty())
+	{
+		header = it->second.back();
+		it->second.pop_back();
+
+		stats.pooled -= capacity;
+		stats.pooledBlocks--;
+		stats.hits++;
+	}
+	else
+		stats.misses++;
+
+	pthread_mutex_unlock(&lock);
+
+	if(header == NULL)
+	{
+		void* memory;
+
+		if(posix_memalign(&memory, ALIGNMENT, capacity + ALIGNMENT) != 0)
+			return NULL;
+
+		header = (BlockHeader*)memory;
+		header->capacity = capacity;
+	}
+
+	pthread_mutex_lock(&lock);
+
+	stats.inUse += capacity;
+	stats.inUseBlocks++;
+
+	if(stats.inUse + stats.pooled > stats.highWater)
+		stats.highWater = stats.inUse + stats.pooled;
+
+	pthread_mutex_unlock(&lock);
+
+	return (unsigned char*)header + ALIGNMENT;
+}
+
+void PixelPool::Release(unsigned char* block)
+{
+	if(block == NULL)
+		return;
+
+	BlockHeader* header = HeaderOf(block);
+	size_t capacity = header->capacity;
+	bool keep;
+
+	pthread_mutex_lock(&lock);
+
+	stats.inUse -= capacity;
+	stats.inUseBlocks--;
+	keep = stats.pooled + capacity <= retain;
+
+	if(keep)
+	{
+		freeLists[capacity].push_back(header);
+		stats.pooled += capacity;
+		stats.pooledBlocks++;
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	if(!keep)
+		free(header);
+}
+
+size_t PixelPool::Capacity(const unsigned char* block)
+{
+	return HeaderOf(block)->capacity;
+}
+
+void PixelPool::SetRetain(size_t bytes)
+{
+	std::vector<BlockHeader*> surplus;
+
+	pthread_mutex_lock(&lock);
+
+	retain = bytes;
+
+	// largest classes go first
+	for(FreeLists::reverse_iterator it = freeLists.rbegin();
+		it != freeLists.rend() && stats.pooled > retain; ++it)
+	{
+		while(!it->second.empty() && stats.pooled > retain)
+		{
+			surplus.push_back(it->second.back());
+			it->second.pop_back();
+
+			stats.pooled -= it->first;
+			stats.pooledBlocks--;
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	for(size_t i = 0; i < surplus.size(); i++)
+		free(surplus[i]);
+}
+
+void PixelPool::GetStats(Stats& out)
+{
+	pthread_mutex_lock(&lock);
+	out = stats;
+	pthread_mutex_unlock(&lock);
+}
+
+}
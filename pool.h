@@ -0,0 +1,49 @@
+#ifndef NODIUM_POOL_H
+#define NODIUM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nodium {
+
+// Pixel buffers for the capture path. Blocks are 64-byte aligned, so any
+// SIMD load is safe and rows never share a cache line with a neighbour.
+// Sizes are rounded up to classes a quarter octave apart, and a released
+// block waits for the next request of its class rather than going back to
+// the allocator. At 1080p and above that keeps every capture from mapping
+// and unmapping megabytes. Safe from any thread.
+class PixelPool
+{
+public:
+	enum { ALIGNMENT = 64 };
+
+	struct Stats
+	{
+		uint64_t inUse;
+		uint64_t inUseBlocks;
+		uint64_t pooled;
+		uint64_t pooledBlocks;
+
+		// largest inUse + pooled seen, i.e. what the pool has cost at worst
+		uint64_t highWater;
+
+		uint64_t hits;
+		uint64_t misses;
+	};
+
+	// At least size bytes; NULL only when the allocator gives up
+	static unsigned char* Acquire(size_t size);
+	static void Release(unsigned char* block);
+
+	// Bytes actually reserved for a block, its class size
+	static size_t Capacity(const unsigned char* block);
+
+	// Free blocks past this many bytes go back to the allocator
+	static void SetRetain(size_t bytes);
+
+	static void GetStats(Stats& out);
+};
+
+}
+
+#endif
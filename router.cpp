@@ -0,0 +1,397 @@
+#include "router.h"
+#include "metrics.h"
+
+#include <node_buffer.h>
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <algorithm>
+
+using namespace v8;
+
+namespace nodium {
+
+// One lock for every router: requests are parked rarely enough that it is
+// never contended, and the wake-up callback can walk all routers under it
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+static std::vector<Router*> routers;
+static unsigned nextSeq = 1;
+
+static uv_async_t wake;
+static bool wakeReady = false;
+static pthread_t mainThread;
+
+static const struct { const char* extension; const char* mimeType; } mimeTypes[] = {
+	{ "html", "text/html" }, { "htm", "text/html" }, { "js", "application/javascript" },
+	{ "json", "application/json" }, { "css", "text/css" }, { "txt", "text/plain" },
+	{ "xml", "text/xml" }, { "svg", "image/svg+xml" }, { "png", "image/png" },
+	{ "jpg", "image/jpeg" }, { "jpeg", "image/jpeg" }, { "gif", "image/gif" },
+	{ "webp", "image/webp" }, { "woff", "font/woff" }, { "woff2", "font/woff2" }
+};
+
+// Routes that name no MIME type get one from the URL's extension
+static const char* GuessMimeType(const std::string& url)
+{
+	size_t end = url.find_first_of("?#");
+	size_t dot = url.find_last_of("./", end == std::string::npos ? std::string::npos : end - 1);
+
+	if(dot != std::string::npos && url[dot] == '.')
+	{
+		std::string extension = url.substr(dot + 1, end == std::string::npos ? end : end - dot - 1);
+
+		for(size_t i = 0; i < sizeof(mimeTypes) / sizeof(mimeTypes[0]); i++)
+		{
+			if(strcasecmp(extension.c_str(), mimeTypes[i].extension) == 0)
+				return mimeTypes[i].mimeType;
+		}
+	}
+
+	return "application/octet-stream";
+}
+
+// Wildcard match over the whole string, '*' matching any run
+static bool Match(const char* pattern, const char* str)
+{
+	const char* star = NULL;
+	const char* resume = NULL;
+
+	while(*str)
+	{
+		if(*pattern == '*')
+		{
+			star = pattern++;
+			resume = str;
+		}
+		else if(*pattern == *str)
+		{
+			pattern++;
+			str++;
+		}
+		else if(star != NULL)
+		{
+			pattern = star + 1;
+			str = ++resume;
+		}
+		else
+			return false;
+	}
+
+	while(*pattern == '*')
+		pattern++;
+
+	return *pattern == 0;
+}
+
+static Awesomium::ResourceResponse* Respond(const char* data, size_t length,
+											const std::string& mimeType, const std::string& url)
+{
+	Metrics::Count(ROUTED_REQUESTS);
+	Metrics::Count(ROUTED_BYTES, length);
+
+	// Create() copies the body and wants a pointer even when it is empty
+	static unsigned char empty[1];
+
+	return Awesomium::ResourceResponse::Create(length,
+		length > 0 ? (unsigned char*)data : empty,
+		mimeType.empty() ? GuessMimeType(url) : mimeType);
+}
+
+void Router::Body::Set(Handle<Value> value)
+{
+	if(!node::Buffer::HasInstance(value))
+		return;
+
+	Local<Object> object = value->ToObject();
+
+	buffer = Persistent<Object>::New(object);
+	data = node::Buffer::Data(object);
+	length = node::Buffer::Length(object);
+}
+
+Router::Router(Listener listener, void* data)
+	: listener(listener), data(data), closed(false)
+{
+	if(!wakeReady)
+	{
+		uv_async_init(uv_default_loop(), &wake, OnWake);
+
+		// a router waiting for requests is no reason to keep the process up
+		uv_unref(uv_default_loop());
+
+		mainThread = pthread_self();
+		wakeReady = true;
+	}
+
+	pthread_mutex_lock(&lock);
+	routers.push_back(this);
+	pthread_mutex_unlock(&lock);
+}
+
+Router::~Router()
+{
+	Close();
+
+	pthread_mutex_lock(&lock);
+
+	routers.erase(std::find(routers.begin(), routers.end(), this));
+
+	for(size_t i = 0; i < rules.size(); i++)
+		rules[i].body.buffer.Dispose();
+
+	for(size_t i = 0; i < garbage.size(); i++)
+		garbage[i].Dispose();
+
+	pthread_mutex_unlock(&lock);
+}
+
+void Router::Add(const std::string& pattern, int handler, Handle<Value> body,
+				 const std::string& mimeType, int timeoutMs)
+{
+	HandleScope scope;
+
+	Rule rule;
+	rule.pattern = pattern;
+	rule.handler = handler;
+	rule.mimeType = mimeType;
+	rule.timeoutMs = timeoutMs;
+
+	rule.body.Set(body);
+
+	pthread_mutex_lock(&lock);
+
+	size_t i = 0;
+
+	while(i < rules.size() && rules[i].pattern != pattern)
+		i++;
+
+	if(i < rules.size())
+	{
+		rules[i].body.buffer.Dispose();
+		rules[i] = rule;
+	}
+	else
+		rules.push_back(rule);
+
+	pthread_mutex_unlock(&lock);
+}
+
+bool Router::Remove(const std::string& pattern)
+{
+	pthread_mutex_lock(&lock);
+
+	for(size_t i = 0; i < rules.size(); i++)
+	{
+		if(rules[i].pattern == pattern)
+		{
+			rules[i].body.buffer.Dispose();
+			rules.erase(rules.begin() + i);
+
+			pthread_mutex_unlock(&lock);
+			return true;
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+	return false;
+}
+
+void Router::Answer(unsigned seq, Handle<Value> body, const std::string& mimeType)
+{
+	HandleScope scope;
+
+	pthread_mutex_lock(&lock);
+
+	for(size_t i = 0; i < parked.size(); i++)
+	{
+		if(parked[i]->seq == seq && !parked[i]->answered)
+		{
+			parked[i]->body.Set(body);
+
+			if(!mimeType.empty())
+				parked[i]->mimeType = mimeType;
+
+			parked[i]->answered = true;
+			pthread_cond_broadcast(&changed);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+void Router::Close()
+{
+	pthread_mutex_lock(&lock);
+
+	closed = true;
+	pthread_cond_broadcast(&changed);
+
+	// the parked threads only wait for us, so they leave right away
+	while(!parked.empty())
+		pthread_cond_wait(&changed, &lock);
+
+	pthread_mutex_unlock(&lock);
+}
+
+void Router::Open()
+{
+	pthread_mutex_lock(&lock);
+	closed = false;
+	pthread_mutex_unlock(&lock);
+}
+
+bool Router::Serve(Awesomium::ResourceRequest* request, Awesomium::ResourceResponse*& response)
+{
+	const std::string& url = request->getURL();
+
+	pthread_mutex_lock(&lock);
+
+	size_t i = 0;
+
+	while(!closed && i < rules.size() && !Match(rules[i].pattern.c_str(), url.c_str()))
+		i++;
+
+	if(closed || i == rules.size())
+	{
+		pthread_mutex_unlock(&lock);
+		return false;
+	}
+
+	if(!rules[i].body.buffer.IsEmpty())
+	{
+		const Rule& rule = rules[i];
+		response = Respond(rule.body.data, rule.body.length, rule.mimeType, url);
+		pthread_mutex_unlock(&lock);
+		return true;
+	}
+
+	// waiting here for JS would wait forever
+	if(pthread_equal(pthread_self(), mainThread))
+	{
+		pthread_mutex_unlock(&lock);
+		Metrics::Count(ROUTED_FAILURES);
+		request->cancel();
+		response = NULL;
+		return true;
+	}
+
+	Parked entry;
+	entry.seq = nextSeq++;
+	entry.handler = rules[i].handler;
+	entry.url = url;
+	entry.method = request->getMethod();
+	entry.delivered = false;
+	entry.answered = false;
+	entry.mimeType = rules[i].mimeType;
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += rules[i].timeoutMs / 1000;
+	deadline.tv_nsec += (long)(rules[i].timeoutMs % 1000) * 1000000;
+
+	if(deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	parked.push_back(&entry);
+	uv_async_send(&wake);
+
+	while(!entry.answered && !closed)
+	{
+		if(pthread_cond_timedwait(&changed, &lock, &deadline) == ETIMEDOUT)
+			break;
+	}
+
+	parked.erase(std::find(parked.begin(), parked.end(), &entry));
+
+	response = NULL;
+
+	if(entry.answered && !closed && !entry.body.buffer.IsEmpty())
+		response = Respond(entry.body.data, entry.body.length, entry.mimeType, url);
+
+	if(!entry.body.buffer.IsEmpty())
+	{
+		garbage.push_back(entry.body.buffer);
+		uv_async_send(&wake);
+	}
+
+	// Close() waits for the parked list to drain
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+
+	if(response == NULL)
+	{
+		Metrics::Count(ROUTED_FAILURES);
+		request->cancel();
+	}
+
+	return true;
+}
+
+// A parked request on its way to the listener
+struct Delivery
+{
+	Router* router;
+	unsigned seq;
+	int handler;
+	std::string url;
+	std::string method;
+};
+
+void Router::OnWake(uv_async_t* handle, int status)
+{
+	std::vector<Delivery> deliveries;
+
+	pthread_mutex_lock(&lock);
+
+	for(size_t i = 0; i < routers.size(); i++)
+	{
+		Router* router = routers[i];
+
+		for(size_t k = 0; k < router->garbage.size(); k++)
+			router->garbage[k].Dispose();
+
+		router->garbage.clear();
+
+		for(size_t k = 0; k < router->parked.size(); k++)
+		{
+			Parked* entry = router->parked[k];
+
+			if(entry->delivered)
+				continue;
+
+			entry->delivered = true;
+
+			Delivery delivery;
+			delivery.router = router;
+			delivery.seq = entry->seq;
+			delivery.handler = entry->handler;
+			delivery.url = entry->url;
+			delivery.method = entry->method;
+			deliveries.push_back(delivery);
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	// listeners may destroy any view, and their router with it
+	for(size_t i = 0; i < deliveries.size(); i++)
+	{
+		const Delivery& delivery = deliveries[i];
+
+		pthread_mutex_lock(&lock);
+		bool alive = std::find(routers.begin(), routers.end(), delivery.router) != routers.end();
+		pthread_mutex_unlock(&lock);
+
+		if(alive)
+			delivery.router->listener(delivery.router->data, delivery.seq, delivery.handler,
+									  delivery.url, delivery.method);
+	}
+}
+
+}
@@ -0,0 +1,104 @@
+#ifndef NODIUM_ROUTER_H
+#define NODIUM_ROUTER_H
+
+#include <v8.h>
+#include <uv.h>
+#include <Awesomium/ResourceInterceptor.h>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+// Answers a view's requests from Buffers held in JS, behind view.route().
+//
+// A route either carries its body, which the interceptor serves without
+// involving JS at all, or names a JS handler. Awesomium wants the answer
+// from onRequest itself, which runs on one of its own threads, so for a
+// handler that thread parks the request, wakes the event loop through a
+// uv_async_t and waits until Answer() is called with the handler's
+// Buffer, the route's timeout passes or the router is closed. Bodies are
+// read straight out of the Buffers, which stay alive until the waiting
+// thread is done with them; ResourceResponse::Create makes the only copy.
+// Their address and length are taken on the main thread, as V8 may move
+// the wrapper objects at any time.
+class Router
+{
+public:
+	// Called on the main thread for every parked request, once
+	typedef void (*Listener)(void* data, unsigned seq, int handler,
+							 const std::string& url, const std::string& method);
+
+	Router(Listener listener, void* data);
+	~Router();
+
+	// Main thread. pattern is a wildcard over the whole URL, where '*'
+	// matches anything; routes are tried in the order they were added and
+	// adding a pattern again replaces it. body is a Buffer for a static
+	// route; otherwise handler is passed back to the listener.
+	void Add(const std::string& pattern, int handler, v8::Handle<v8::Value> body,
+			 const std::string& mimeType, int timeoutMs);
+	bool Remove(const std::string& pattern);
+
+	// Main thread. Serves body, a Buffer, to the parked request seq, or
+	// cancels it when body is anything else. Unknown seqs are ignored.
+	void Answer(unsigned seq, v8::Handle<v8::Value> body, const std::string& mimeType);
+
+	// Main thread. Cancels everything parked, and refuses new work until
+	// Open(); returns once no interceptor thread is inside the router.
+	void Close();
+	void Open();
+
+	// Interceptor thread. True when a route matched: response is then set,
+	// or the request has been cancelled.
+	bool Serve(Awesomium::ResourceRequest* request, Awesomium::ResourceResponse*& response);
+
+private:
+	Router(const Router&);
+	Router& operator=(const Router&);
+
+	// a Buffer, pinned for as long as data is in use
+	struct Body
+	{
+		v8::Persistent<v8::Object> buffer;
+		const char* data;
+		size_t length;
+
+		void Set(v8::Handle<v8::Value> value);
+	};
+
+	struct Rule
+	{
+		std::string pattern;
+		int handler;
+		Body body;
+		std::string mimeType;
+		int timeoutMs;
+	};
+
+	struct Parked
+	{
+		unsigned seq;
+		int handler;
+		std::string url;
+		std::string method;
+		bool delivered;
+		bool answered;
+		Body body;
+		std::string mimeType;
+	};
+
+	static void OnWake(uv_async_t* handle, int status);
+
+	Listener listener;
+	void* data;
+	bool closed;
+	std::vector<Rule> rules;
+	std::vector<Parked*> parked;
+
+	// Buffers the interceptor is done with, released on the main thread
+	std::vector<v8::Persistent<v8::Object> > garbage;
+};
+
+}
+
+#endif
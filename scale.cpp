@@ -0,0 +1,331 @@
+#include "scale.h"
+#include "pool.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+// Filter weights are fixed point with this many fractional bits and sum to
+// exactly 1 for every output pixel
+#define WEIGHT_BITS 14
+
+// Horizontally filtered rows keep this many fractional bits in int16,
+// leaving headroom for Lanczos overshoot
+#define ROW_BITS 6
+
+#define LANCZOS_LOBES 3
+
+namespace nodium {
+
+// Contributions of source pixels to one output pixel along one axis
+struct Taps
+{
+	int start;
+	std::vector<int16_t> weights;
+};
+
+static double Sinc(double x)
+{
+	if(x == 0)
+		return 1;
+
+	x *= M_PI;
+	return sin(x) / x;
+}
+
+static double Lanczos(double x)
+{
+	return x > -LANCZOS_LOBES && x < LANCZOS_LOBES ? Sinc(x) * Sinc(x / LANCZOS_LOBES) : 0;
+}
+
+// Weights for every output index along an axis of the given sizes, with
+// taps past either edge folded onto the edge pixel
+static void BuildTaps(int srcSize, int destSize, ScaleFilter filter, std::vector<Taps>& taps)
+{
+	double scale = (double)srcSize / destSize;
+	double stretch = scale > 1 ? scale : 1;
+	std::vector<double> raw;
+
+	taps.resize(destSize);
+
+	for(int d = 0; d < destSize; d++)
+	{
+		int first, last;
+
+		raw.clear();
+
+		if(filter == SCALE_AREA)
+		{
+			// the output pixel covers [lo, hi) of the source
+			double lo = d * scale;
+			double hi = (d + 1) * scale;
+
+			first = (int)floor(lo);
+			last = (int)ceil(hi) - 1;
+
+			if(last >= srcSize)
+				last = srcSize - 1;
+
+			for(int s = first; s <= last; s++)
+			{
+				double from = s > lo ? s : lo;
+				double to = s + 1 < hi ? s + 1 : hi;
+				raw.push_back(to > from ? to - from : 0);
+			}
+		}
+		else
+		{
+			double center = (d + 0.5) * scale - 0.5;
+			double support = LANCZOS_LOBES * stretch;
+
+			first = (int)ceil(center - support);
+			last = (int)floor(center + support);
+
+			for(int s = first; s <= last; s++)
+				raw.push_back(Lanczos((s - center) / stretch));
+		}
+
+		double total = 0;
+
+		for(size_t i = 0; i < raw.size(); i++)
+			total += raw[i];
+
+		// fold taps outside the image onto its edges
+		int lo = first < 0 ? 0 : first;
+		int hi = last >= srcSize ? srcSize - 1 : last;
+		std::vector<double> folded(hi - lo + 1, 0.0);
+
+		for(int s = first; s <= last; s++)
+		{
+			int clamped = s < 0 ? 0 : s >= srcSize ? srcSize - 1 : s;
+			folded[clamped - lo] += raw[s - first] / total;
+		}
+
+		Taps& t = taps[d];
+		t.start = lo;
+		t.weights.resize(folded.size());
+
+		int sum = 0;
+		size_t peak = 0;
+
+		for(size_t i = 0; i < folded.size(); i++)
+		{
+			t.weights[i] = (int16_t)floor(folded[i] * (1 << WEIGHT_BITS) + 0.5);
+			sum += t.weights[i];
+
+			if(folded[i] > folded[peak])
+				peak = i;
+		}
+
+		// rounding must not brighten or darken the image
+		t.weights[peak] += (int16_t)((1 << WEIGHT_BITS) - sum);
+	}
+}
+
+// One output size: tap tables for both axes, the horizontally filtered
+// row being worked on and an accumulator for the whole output
+struct Resampler
+{
+	ScaleTarget* target;
+	std::vector<Taps> columns;
+
+	// for each source row, the output rows it feeds and with what weight
+	std::vector<std::vector<std::pair<int, int16_t> > > rowFeeds;
+
+	// four channels per pixel, padded to an even pixel count; the
+	// accumulator is the big one and comes from the pixel pool
+	std::vector<int16_t> row;
+	int32_t* accumulator;
+	int paddedWidth;
+};
+
+static void FilterRow(const unsigned char* src, Resampler& r)
+{
+	int16_t* out = &r.row[0];
+
+	for(int x = 0; x < r.target->width; x++)
+	{
+		const Taps& taps = r.columns[x];
+		const unsigned char* p = src + taps.start * 4;
+		size_t count = taps.weights.size();
+		size_t i = 0;
+
+#if defined(__SSE2__)
+		const __m128i zero = _mm_setzero_si128();
+		__m128i sum = _mm_setzero_si128();
+
+		// two source pixels per madd: channels interleaved pixel by pixel,
+		// weights interleaved to match
+		for(; i + 2 <= count; i += 2)
+		{
+			__m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)(p + i * 4)), zero);
+			__m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)(p + i * 4 + 4)), zero);
+			__m128i w = _mm_set1_epi32((int)(((uint32_t)(uint16_t)taps.weights[i + 1] << 16) |
+											 (uint16_t)taps.weights[i]));
+
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+		}
+
+		if(i < count)
+		{
+			__m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)(p + i * 4)), zero);
+			__m128i w = _mm_set1_epi32((uint16_t)taps.weights[i]);
+
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), w));
+		}
+
+		sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (WEIGHT_BITS - ROW_BITS - 1))),
+							 WEIGHT_BITS - ROW_BITS);
+		_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packs_epi32(sum, sum));
+#else
+		int32_t sum[4] = { 0, 0, 0, 0 };
+
+		for(; i < count; i++)
+		{
+			for(int c = 0; c < 4; c++)
+				sum[c] += p[i * 4 + c] * taps.weights[i];
+		}
+
+		for(int c = 0; c < 4; c++)
+		{
+			int32_t v = (sum[c] + (1 << (WEIGHT_BITS - ROW_BITS - 1))) >> (WEIGHT_BITS - ROW_BITS);
+			out[x * 4 + c] = (int16_t)(v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+		}
+#endif
+	}
+}
+
+static void Accumulate(const int16_t* row, int16_t weight, int32_t* acc, int values)
+{
+	int i = 0;
+
+#if defined(__SSE2__)
+	const __m128i w = _mm_set1_epi16(weight);
+
+	// eight channels (two pixels) per round; mullo/mulhi give the full
+	// 32-bit products
+	for(; i + 8 <= values; i += 8)
+	{
+		__m128i h = _mm_loadu_si128((const __m128i*)(row + i));
+		__m128i lo = _mm_mullo_epi16(h, w);
+		__m128i hi = _mm_mulhi_epi16(h, w);
+		__m128i* out = (__m128i*)(acc + i);
+
+		_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(lo, hi)));
+	}
+#endif
+
+	for(; i < values; i++)
+		acc[i] += row[i] * weight;
+}
+
+static void Resolve(const int32_t* acc, unsigned char* dest, int values)
+{
+	const int shift = WEIGHT_BITS + ROW_BITS;
+	int i = 0;
+
+#if defined(__SSE2__)
+	const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+
+	for(; i + 8 <= values; i += 8)
+	{
+		__m128i a = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i*)(acc + i)), round), shift);
+		__m128i b = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i*)(acc + i + 4)), round), shift);
+		__m128i packed = _mm_packs_epi32(a, b);
+
+		_mm_storel_epi64((__m128i*)(dest + i), _mm_packus_epi16(packed, packed));
+	}
+#endif
+
+	for(; i < values; i++)
+	{
+		int32_t v = (acc[i] + (1 << (shift - 1))) >> shift;
+		dest[i] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+	}
+}
+
+bool Downscale(const unsigned char* src, int width, int height, int rowSpan,
+			   ScaleFilter filter, std::vector<ScaleTarget>& targets)
+{
+	std::vector<Resampler> resamplers(targets.size());
+
+	for(size_t t = 0; t < targets.size(); t++)
+	{
+		Resampler& r = resamplers[t];
+		ScaleTarget& target = targets[t];
+		std::vector<Taps> rows;
+
+		r.target = &target;
+		r.paddedWidth = (target.width + 1) & ~1;
+		r.row.assign(r.paddedWidth * 4, 0);
+		r.rowFeeds.resize(height);
+
+		size_t bytes = (size_t)r.paddedWidth * 4 * target.height * sizeof(int32_t);
+		r.accumulator = (int32_t*)PixelPool::Acquire(bytes);
+
+		if(r.accumulator == NULL)
+		{
+			for(size_t i = 0; i < t; i++)
+				PixelPool::Release((unsigned char*)resamplers[i].accumulator);
+
+			return false;
+		}
+
+		memset(r.accumulator, 0, bytes);
+
+		BuildTaps(width, target.width, filter, r.columns);
+		BuildTaps(height, target.height, filter, rows);
+
+		for(int d = 0; d < target.height; d++)
+		{
+			for(size_t i = 0; i < rows[d].weights.size(); i++)
+			{
+				if(rows[d].weights[i] != 0)
+					r.rowFeeds[rows[d].start + i].push_back(std::make_pair(d, rows[d].weights[i]));
+			}
+		}
+	}
+
+	// the single pass: each source row is read once and feeds every target
+	for(int y = 0; y < height; y++)
+	{
+		const unsigned char* line = src + (size_t)y * rowSpan;
+
+		for(size_t t = 0; t < resamplers.size(); t++)
+		{
+			Resampler& r = resamplers[t];
+			const std::vector<std::pair<int, int16_t> >& feeds = r.rowFeeds[y];
+
+			if(feeds.empty())
+				continue;
+
+			FilterRow(line, r);
+
+			for(size_t f = 0; f < feeds.size(); f++)
+				Accumulate(&r.row[0], feeds[f].second,
+						   &r.accumulator[(size_t)feeds[f].first * r.paddedWidth * 4],
+						   r.paddedWidth * 4);
+		}
+	}
+
+	for(size_t t = 0; t < resamplers.size(); t++)
+	{
+		Resampler& r = resamplers[t];
+		ScaleTarget& target = *r.target;
+
+		for(int y = 0; y < target.height; y++)
+			Resolve(&r.accumulator[(size_t)y * r.paddedWidth * 4],
+					&target.pixels[(size_t)y * target.width * 4], target.width * 4);
+
+		PixelPool::Release((unsigned char*)r.accumulator);
+	}
+
+	return true;
+}
+
+}
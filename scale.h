@@ -0,0 +1,37 @@
+#ifndef NODIUM_SCALE_H
+#define NODIUM_SCALE_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace nodium {
+
+enum ScaleFilter
+{
+	// box filter weighted by exact pixel coverage; the right choice for
+	// thumbnails and what every caller gets unless it asks otherwise
+	SCALE_AREA = 0,
+
+	// Lanczos-3, sharper on text at the cost of a wider kernel
+	SCALE_LANCZOS
+};
+
+struct ScaleTarget
+{
+	int width;
+	int height;
+
+	// BGRA, width * 4 bytes per row, provided by the caller
+	unsigned char* pixels;
+};
+
+// Resamples BGRA pixels into every target in a single pass over the source
+// rows, so several thumbnail sizes cost one read of the full-size render.
+// Pure computation, safe on worker threads. Fails only when scratch memory
+// cannot be had.
+bool Downscale(const unsigned char* src, int width, int height, int rowSpan,
+			   ScaleFilter filter, std::vector<ScaleTarget>& targets);
+
+}
+
+#endif
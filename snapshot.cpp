@@ -0,0 +1,205 @@
+#include "snapshot.h"
+#include "utf.h"
+
+// Bounds a count read off the page before anything is sized from it
+#define SNAPSHOT_MAX_COUNT 0x7FFFFFF
+
+#define NODE_ELEMENT 1
+#define NODE_TEXT 3
+
+namespace nodium {
+
+// Iterative so deep documents cannot overflow the page's stack. Nodes are
+// numbered from 1 as they are popped, which is document order since
+// children go on the stack last to first. Keys get a prefix so a string
+// like "__proto__" is just another key.
+static const char walkerSource[] =
+	"(function(){"
+	"var strings=[],lengths=[],ids=Object.create(null),out=[0,0,0],"
+		"stack=[],parents=[],nodes=0,attributes=0,root=document.documentElement;"
+	"function id(s){"
+		"var i=ids['$'+s];"
+		"if(i===undefined){i=ids['$'+s]=strings.length;strings.push(s);lengths.push(s.length);}"
+		"return i;"
+	"}"
+	"if(root){stack.push(root);parents.push(0);}"
+	"while(stack.length){"
+		"var node=stack.pop(),parent=parents.pop(),self=++nodes;"
+		"if(node.nodeType===1){"
+			"var a=node.attributes,n=a.length;"
+			"out.push(1,parent,id(node.nodeName.toLowerCase()),0,n);"
+			"for(var i=0;i<n;i++)out.push(id(a[i].name),id(a[i].value));"
+			"attributes+=n;"
+			"for(var c=node.lastChild;c;c=c.previousSibling)"
+				"if(c.nodeType===1||(c.nodeType===3&&/\\S/.test(c.nodeValue))){"
+					"stack.push(c);parents.push(self);"
+				"}"
+		"}else out.push(3,parent,id('#text'),id(node.nodeValue)+1,0);"
+	"}"
+	"out[0]=nodes;out[1]=attributes;out[2]=strings.length;"
+	"for(var j=0;j<lengths.length;j++)out.push(lengths[j]);"
+	"for(var k=0;k<out.length;k++)out[k]=out[k].toString(36);"
+	"return out.join(',')+'|'+strings.join('');"
+	"})()";
+
+const std::wstring& DomSnapshot::Walker()
+{
+	// ASCII, so widening is a plain copy
+	static const std::wstring walker(walkerSource, walkerSource + sizeof(walkerSource) - 1);
+	return walker;
+}
+
+static inline int Base36(wchar_t c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+
+	if(c >= 'a' && c <= 'z')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+// Reads one integer and the ',' after it, if it is not the last one
+static bool ReadCount(const wchar_t*& cursor, const wchar_t* end, uint32_t& out)
+{
+	uint32_t value = 0;
+	const wchar_t* start = cursor;
+
+	for(int digit; cursor < end && (digit = Base36(*cursor)) >= 0; cursor++)
+	{
+		value = value * 36 + digit;
+
+		if(value > SNAPSHOT_MAX_COUNT)
+			return false;
+	}
+
+	if(cursor == start || (cursor < end && *cursor++ != ','))
+		return false;
+
+	out = value;
+	return true;
+}
+
+// Number of wide units that hold the given number of UTF-16 units, or
+// (size_t)-1 when that would run past the end or split a pair
+static size_t WideUnits(const wchar_t* src, size_t available, size_t utf16)
+{
+#if defined(NODIUM_WIDE_UTF32)
+	size_t i = 0;
+
+	for(size_t units = 0; units < utf16; i++)
+	{
+		if(i == available)
+			return (size_t)-1;
+
+		units += (uint32_t)src[i] >= 0x10000 ? 2 : 1;
+
+		if(units > utf16)
+			return (size_t)-1;
+	}
+
+	return i;
+#else
+	return utf16 <= available ? utf16 : (size_t)-1;
+#endif
+}
+
+bool DomSnapshot::Decode(std::wstring& encoded)
+{
+	source.swap(encoded);
+
+	// integers are ASCII, so the first '|' is the one that ends them
+	size_t bar = source.find(L'|');
+
+	if(bar == std::wstring::npos || bar == 0 || source[bar - 1] == ',')
+		return false;
+
+	const wchar_t* cursor = source.data();
+	const wchar_t* end = cursor + bar;
+
+	uint32_t nodeCount, attributeCount, stringCount;
+
+	if(!ReadCount(cursor, end, nodeCount) || !ReadCount(cursor, end, attributeCount) ||
+	   !ReadCount(cursor, end, stringCount))
+		return false;
+
+	// every node takes five integers and every attribute two more, so
+	// counts the input cannot back are rejected before sizing anything
+	if(((uint64_t)nodeCount * 5 + (uint64_t)attributeCount * 2 + stringCount) * 2 >
+	   (uint64_t)(end - cursor) + 1)
+		return false;
+
+	types.resize(nodeCount);
+	parents.resize(nodeCount);
+	names.resize(nodeCount);
+	texts.resize(nodeCount);
+	attributeStart.resize(nodeCount + 1);
+	attributeNames.resize(attributeCount);
+	attributeValues.resize(attributeCount);
+	strings.resize(stringCount);
+
+	uint32_t attribute = 0;
+
+	for(uint32_t i = 0; i < nodeCount; i++)
+	{
+		uint32_t type, parent, name, text, count;
+
+		if(!ReadCount(cursor, end, type) || !ReadCount(cursor, end, parent) ||
+		   !ReadCount(cursor, end, name) || !ReadCount(cursor, end, text) ||
+		   !ReadCount(cursor, end, count))
+			return false;
+
+		// parents always come first, and only the root has none
+		if((type != NODE_ELEMENT && type != NODE_TEXT) || parent > i || (parent == 0) != (i == 0) ||
+		   name >= stringCount || text > stringCount || count > attributeCount - attribute)
+			return false;
+
+		types[i] = (uint8_t)type;
+		parents[i] = (int32_t)parent - 1;
+		names[i] = name;
+		texts[i] = (int32_t)text - 1;
+		attributeStart[i] = attribute;
+
+		for(uint32_t last = attribute + count; attribute < last; attribute++)
+		{
+			if(!ReadCount(cursor, end, attributeNames[attribute]) ||
+			   !ReadCount(cursor, end, attributeValues[attribute]) ||
+			   attributeNames[attribute] >= stringCount || attributeValues[attribute] >= stringCount)
+				return false;
+		}
+	}
+
+	if(attribute != attributeCount)
+		return false;
+
+	attributeStart[nodeCount] = attribute;
+
+	std::vector<uint32_t> lengths(stringCount);
+
+	for(uint32_t i = 0; i < stringCount; i++)
+	{
+		if(!ReadCount(cursor, end, lengths[i]))
+			return false;
+	}
+
+	if(cursor != end)
+		return false;
+
+	size_t offset = bar + 1;
+
+	for(uint32_t i = 0; i < stringCount; i++)
+	{
+		size_t units = WideUnits(source.data() + offset, source.size() - offset, lengths[i]);
+
+		if(units == (size_t)-1)
+			return false;
+
+		strings[i] = std::make_pair(offset, units);
+		offset += units;
+	}
+
+	return offset == source.size();
+}
+
+}
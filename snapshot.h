@@ -0,0 +1,73 @@
+#ifndef NODIUM_SNAPSHOT_H
+#define NODIUM_SNAPSHOT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+// The DOM of the main frame as flat columns, one entry per node in
+// document order: elements and text nodes that are not only whitespace.
+// Names, attribute names and values and texts are indices into a table
+// of distinct strings.
+//
+// The page side is a walker injected through executeJavascriptWithResult.
+// It hands back a single string, so a whole document crosses the IPC
+// boundary as one JSValue rather than one per node:
+//
+//   nodes,attributes,strings,<records>,<string lengths>|<strings>
+//
+// with every integer in base 36. A record is type, parent + 1, name,
+// text + 1, attribute count and a name, value pair per attribute.
+// String lengths are in UTF-16 units, as the page counts them.
+//
+// Nothing here touches V8; View::Snapshot turns the columns into typed
+// arrays.
+class DomSnapshot
+{
+public:
+	// Source of the walker, to run as is
+	static const std::wstring& Walker();
+
+	// Takes the walker's output over and splits it into columns; false
+	// when it is malformed
+	bool Decode(std::wstring& encoded);
+
+	size_t Nodes() const { return types.size(); }
+
+	// Parents and texts are -1 where there is none, and the attributes of
+	// node i are attributeStart[i] up to attributeStart[i + 1]
+	const std::vector<uint8_t>& Types() const { return types; }
+	const std::vector<int32_t>& Parents() const { return parents; }
+	const std::vector<uint32_t>& Names() const { return names; }
+	const std::vector<int32_t>& Texts() const { return texts; }
+	const std::vector<uint32_t>& AttributeStart() const { return attributeStart; }
+	const std::vector<uint32_t>& AttributeNames() const { return attributeNames; }
+	const std::vector<uint32_t>& AttributeValues() const { return attributeValues; }
+
+	// Distinct string i, pointing into the decoded input
+	size_t Strings() const { return strings.size(); }
+	const wchar_t* String(size_t i, size_t& length) const
+	{
+		length = strings[i].second;
+		return source.data() + strings[i].first;
+	}
+
+private:
+	std::wstring source;
+	std::vector<uint8_t> types;
+	std::vector<int32_t> parents;
+	std::vector<uint32_t> names;
+	std::vector<int32_t> texts;
+	std::vector<uint32_t> attributeStart;
+	std::vector<uint32_t> attributeNames;
+	std::vector<uint32_t> attributeValues;
+
+	// offset and length in source of each distinct string
+	std::vector<std::pair<size_t, size_t> > strings;
+};
+
+}
+
+#endif
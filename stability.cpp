@@ -0,0 +1,185 @@
+#include "stability.h"
+#include "pixels.h"
+#include "metrics.h"
+
+#include <algorithm>
+
+using namespace v8;
+
+#define DEFAULT_THRESHOLD 0.5
+#define DEFAULT_QUIET_MS 300
+#define DEFAULT_INTERVAL_MS 50
+#define DEFAULT_MAX_WAIT_MS 10000
+
+namespace nodium {
+
+FrameDiff::FrameDiff()
+	: blocksWide(0), blocksHigh(0)
+{
+}
+
+void FrameDiff::Reset()
+{
+	blocksWide = 0;
+	blocksHigh = 0;
+	signature.clear();
+}
+
+double FrameDiff::Update(const Awesomium::RenderBuffer* buffer, const Awesomium::Rect& dirty)
+{
+	int wide = buffer->width / LUMA_BLOCK;
+	int high = buffer->height / LUMA_BLOCK;
+
+	if(wide == 0 || high == 0)
+		return 0;
+
+	// nothing to compare against: take the whole frame
+	if(wide != blocksWide || high != blocksHigh)
+	{
+		blocksWide = wide;
+		blocksHigh = high;
+		signature.resize((size_t)wide * high);
+
+		for(int y = 0; y < high; y++)
+			BlockLuma(buffer->buffer + (size_t)y * LUMA_BLOCK * buffer->rowSpan, buffer->rowSpan,
+					  wide, &signature[(size_t)y * wide]);
+
+		return 255;
+	}
+
+	// the dirty rectangle, widened to whole blocks; partial blocks on the
+	// right and bottom edges are never compared
+	int left = dirty.x / LUMA_BLOCK;
+	int top = dirty.y / LUMA_BLOCK;
+	int right = (dirty.x + dirty.width + LUMA_BLOCK - 1) / LUMA_BLOCK;
+	int bottom = (dirty.y + dirty.height + LUMA_BLOCK - 1) / LUMA_BLOCK;
+
+	if(left < 0)
+		left = 0;
+
+	if(top < 0)
+		top = 0;
+
+	if(right > wide)
+		right = wide;
+
+	if(bottom > high)
+		bottom = high;
+
+	if(left >= right || top >= bottom)
+		return 0;
+
+	uint64_t total = 0;
+	row.resize(right - left);
+
+	for(int y = top; y < bottom; y++)
+	{
+		unsigned char* old = &signature[(size_t)y * wide + left];
+
+		BlockLuma(buffer->buffer + (size_t)y * LUMA_BLOCK * buffer->rowSpan + left * LUMA_BLOCK * 4,
+				  buffer->rowSpan, right - left, &row[0]);
+
+		total += SumAbsDiff(old, &row[0], row.size());
+		std::copy(row.begin(), row.end(), old);
+	}
+
+	// over the blocks compared, not the frame: a small region still
+	// changing must not be diluted by all the pixels that were not redrawn
+	return (double)total / ((size_t)(right - left) * (bottom - top));
+}
+
+StabilityOptions::StabilityOptions()
+	: threshold(DEFAULT_THRESHOLD), quiet(DEFAULT_QUIET_MS), interval(DEFAULT_INTERVAL_MS),
+	  maxWait(DEFAULT_MAX_WAIT_MS)
+{
+}
+
+static uint64_t GetTime(Local<Object> options, const char* name, uint64_t fallback)
+{
+	Local<Value> value = options->Get(String::NewSymbol(name));
+	return value->IsNumber() && value->IntegerValue() >= 0 ? (uint64_t)value->IntegerValue() : fallback;
+}
+
+void StabilityOptions::Parse(Handle<Value> value)
+{
+	HandleScope scope;
+
+	if(!value->IsObject())
+		return;
+
+	Local<Object> given = value->ToObject();
+	Local<Value> limit = given->Get(String::NewSymbol("threshold"));
+
+	if(limit->IsNumber() && limit->NumberValue() >= 0)
+		threshold = limit->NumberValue();
+
+	quiet = GetTime(given, "quiet", quiet);
+	interval = GetTime(given, "interval", interval);
+	maxWait = GetTime(given, "maxWait", maxWait);
+}
+
+StabilityWatch::StabilityWatch()
+	: active(false), timedOut(false), score(0), startedAt(0), quietSince(0), lastRender(0),
+	  waited(0)
+{
+}
+
+void StabilityWatch::Start(const StabilityOptions& given, uint64_t now)
+{
+	options = given;
+	diff.Reset();
+	active = true;
+	timedOut = false;
+	score = 255;
+	startedAt = now;
+	quietSince = now;
+	lastRender = 0;
+	waited = 0;
+}
+
+void StabilityWatch::Stop()
+{
+	active = false;
+}
+
+bool StabilityWatch::Poll(Awesomium::WebView* webView, uint64_t now)
+{
+	if(!active)
+		return false;
+
+	// an untouched view shows the same frame; only the clock moves
+	if(webView->isDirty() && now - lastRender >= options.interval)
+	{
+		Awesomium::Rect dirty = webView->getDirtyBounds();
+		const Awesomium::RenderBuffer* buffer;
+
+		{
+			ScopedLatency latency(RENDER);
+			buffer = webView->render();
+		}
+
+		lastRender = now;
+
+		if(buffer != NULL)
+		{
+			score = diff.Update(buffer, dirty);
+
+			if(score > options.threshold)
+				quietSince = now;
+		}
+	}
+
+	// changes not yet looked at because of the interval hold off settling
+	bool settled = !webView->isDirty() && now - quietSince >= options.quiet;
+	timedOut = !settled && now - startedAt >= options.maxWait;
+
+	if(!settled && !timedOut)
+		return false;
+
+	active = false;
+	waited = now - startedAt;
+
+	return true;
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef NODIUM_STABILITY_H
+#define NODIUM_STABILITY_H
+
+#include <v8.h>
+#include <stdint.h>
+#include <Awesomium/WebView.h>
+#include <vector>
+
+namespace nodium {
+
+// Luma signature of the last frame seen, one byte per LUMA_BLOCK square.
+// Only the dirty rectangle of each new frame is reduced and compared.
+class FrameDiff
+{
+public:
+	FrameDiff();
+
+	// Folds the dirty part of a frame into the signature and returns how
+	// much it changed: the mean absolute luma difference per block over the
+	// dirty blocks, 0 to 255. The first frame, or a resized one, scores 255.
+	double Update(const Awesomium::RenderBuffer* buffer, const Awesomium::Rect& dirty);
+
+	void Reset();
+
+private:
+	int blocksWide;
+	int blocksHigh;
+	std::vector<unsigned char> signature;
+	std::vector<unsigned char> row;
+};
+
+// { threshold, quiet, interval, maxWait }; times in milliseconds
+struct StabilityOptions
+{
+	double threshold;
+	uint64_t quiet;
+	uint64_t interval;
+	uint64_t maxWait;
+
+	StabilityOptions();
+
+	// true or an object; anything else leaves the defaults alone
+	void Parse(v8::Handle<v8::Value> value);
+};
+
+// Waits for a page to stop changing on screen: renders it every interval
+// while it is dirty, and reports it stable once successive frames have
+// stayed under the threshold for quiet ms, or maxWait ms after Start().
+class StabilityWatch
+{
+public:
+	StabilityWatch();
+
+	void Start(const StabilityOptions& options, uint64_t now);
+	void Stop();
+	bool Active() const { return active; }
+
+	// Call after every update(); true once the page is stable or maxWait
+	// has passed, after which the watch is no longer active
+	bool Poll(Awesomium::WebView* webView, uint64_t now);
+
+	// Result of the last wait
+	bool TimedOut() const { return timedOut; }
+	double Score() const { return score; }
+	uint64_t Waited() const { return waited; }
+
+private:
+	StabilityOptions options;
+	FrameDiff diff;
+	bool active;
+	bool timedOut;
+	double score;
+	uint64_t startedAt;
+	uint64_t quietSince;
+	uint64_t lastRender;
+	uint64_t waited;
+};
+
+}
+
+#endif
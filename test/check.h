@@ -0,0 +1,33 @@
+#ifndef NODIUM_TEST_CHECK_H
+#define NODIUM_TEST_CHECK_H
+
+#include <stdio.h>
+
+// The native tests are plain programs: every CHECK that fails is printed
+// and Finish() makes the exit status non-zero, so waf or a shell loop can
+// run them without a framework.
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if(!(condition)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while(0)
+
+static int Finish(const char* name)
+{
+	if(failures)
+	{
+		fprintf(stderr, "%s: %d checks failed\n", name, failures);
+		return 1;
+	}
+
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+#endif
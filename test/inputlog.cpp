@@ -0,0 +1,146 @@
+// Round trips through the recorded input log format of EncodeInputLog and
+// DecodeInputLog, and logs it has to turn down.
+
+#include "input.h"
+#include "check.h"
+
+#include <string.h>
+
+using namespace nodium;
+
+static InputEvent Event(int32_t type, int32_t delay, int32_t a = 0, int32_t b = 0, int32_t c = 0,
+						int32_t d = 0, int32_t e = 0, int32_t f = 0)
+{
+	InputEvent event;
+	int32_t fields[INPUT_FIELDS - 2] = { a, b, c, d, e, f };
+
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.delay = delay;
+
+	// fields a type does not use are not logged, so leave them zero
+	for(int i = 0; i < InputFieldCount(type); i++)
+		event.fields[i] = fields[i];
+
+	return event;
+}
+
+static bool Same(const std::vector<InputEvent>& a, const std::vector<InputEvent>& b)
+{
+	return a.size() == b.size() &&
+		   (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(InputEvent)) == 0);
+}
+
+static std::vector<InputEvent> Session()
+{
+	std::vector<InputEvent> events;
+
+	events.push_back(Event(INPUT_MOUSE_MOVE, 0, 10, 20));
+	events.push_back(Event(INPUT_MOUSE_MOVE, 16, -5, 100000));
+	events.push_back(Event(INPUT_MOUSE_DOWN, 3, Awesomium::LEFT_MOUSE_BTN));
+	events.push_back(Event(INPUT_MOUSE_UP, 120, Awesomium::LEFT_MOUSE_BTN));
+	events.push_back(Event(INPUT_MOUSE_WHEEL, 0x7FFFFFFF, -120, 0x7FFFFFFF));
+	events.push_back(Event(INPUT_MOUSE_WHEEL, 8, (int32_t)0x80000000, -1));
+	events.push_back(Event(INPUT_KEY, 40, Awesomium::WebKeyboardEvent::TYPE_KEY_DOWN, 0, 65, 30,
+						   'a', 'a'));
+	events.push_back(Event(INPUT_KEY, 0, Awesomium::WebKeyboardEvent::TYPE_CHAR | INPUT_SYSTEM_KEY,
+						   2, 65, 30, 0xDE00D83D, 'a'));
+
+	return events;
+}
+
+static void TestRoundTrip()
+{
+	std::vector<InputEvent> events = Session();
+	std::string log;
+	EncodeInputLog(events, log);
+
+	CHECK(log.compare(0, 4, "NDIN") == 0);
+
+	// compact: well under a 32 byte record per event
+	CHECK(log.size() < events.size() * 16);
+
+	std::vector<InputEvent> decoded;
+	CHECK(DecodeInputLog(log.data(), log.size(), decoded));
+	CHECK(Same(decoded, events));
+
+	// decoding appends
+	CHECK(DecodeInputLog(log.data(), log.size(), decoded));
+	CHECK(decoded.size() == 2 * events.size());
+
+	std::string empty;
+	EncodeInputLog(std::vector<InputEvent>(), empty);
+	CHECK(empty.size() == 5);
+
+	decoded.clear();
+	CHECK(DecodeInputLog(empty.data(), empty.size(), decoded));
+	CHECK(decoded.empty());
+}
+
+static void TestRejected()
+{
+	std::vector<InputEvent> events = Session();
+	std::string log;
+	EncodeInputLog(events, log);
+
+	std::vector<InputEvent> decoded(1, events[0]);
+
+	// cut anywhere but between two events, a log fails and leaves out as
+	// it was
+	size_t boundaries = 0;
+
+	for(size_t length = 0; length < log.size(); length++)
+	{
+		if(DecodeInputLog(log.data(), length, decoded))
+		{
+			boundaries++;
+			decoded.resize(1);
+		}
+
+		CHECK(decoded.size() == 1);
+	}
+
+	CHECK(boundaries == events.size());
+
+	std::string bad = log;
+	bad[0] = 'X';
+	CHECK(!DecodeInputLog(bad.data(), bad.size(), decoded));
+
+	bad = log;
+	bad[4] = 2;
+	CHECK(!DecodeInputLog(bad.data(), bad.size(), decoded));
+
+	// a varint longer than five bytes
+	bad = log.substr(0, 5) + "\x81\xFF\xFF\xFF\xFF\xFF\x01";
+	CHECK(!DecodeInputLog(bad.data(), bad.size(), decoded));
+
+	// unknown type, negative delay and a mouse button out of range
+	std::vector<InputEvent> invalid;
+	invalid.push_back(Event(INPUT_MOUSE_MOVE, 0, 1, 2));
+	invalid.push_back(Event(INPUT_MOUSE_MOVE, 0, 1, 2));
+
+	invalid[1].type = 99;
+	bad.clear();
+	EncodeInputLog(invalid, bad);
+	CHECK(!DecodeInputLog(bad.data(), bad.size(), decoded));
+
+	invalid[1] = Event(INPUT_MOUSE_MOVE, -1, 1, 2);
+	bad.clear();
+	EncodeInputLog(invalid, bad);
+	CHECK(!DecodeInputLog(bad.data(), bad.size(), decoded));
+
+	invalid[1] = Event(INPUT_MOUSE_DOWN, 0, Awesomium::RIGHT_MOUSE_BTN + 1);
+	bad.clear();
+	EncodeInputLog(invalid, bad);
+	CHECK(!DecodeInputLog(bad.data(), bad.size(), decoded));
+
+	CHECK(decoded.size() == 1);
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestRejected();
+
+	return Finish("inputlog");
+}
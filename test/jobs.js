@@ -0,0 +1,19 @@
+var util = require("util");
+var awesomium = require("../awesomium");
+
+var queue = awesomium.createQueue({ maxViews: 2, maxQueued: 4 });
+
+queue.on("pressure", function (reason, state){
+	console.log("pressure: " + reason + " " + util.inspect(state));
+});
+
+queue.on("drain", function (){
+	console.log("drain");
+});
+
+for(var i = 0; i < 8; i++) (function (i){
+	var accepted = queue.submit({ html: "<p>job " + i + "</p>" }, function (err){
+		console.log("job " + i + ": " + (err ? err.code : "ok"));
+	});
+	console.log("submit " + i + ": " + accepted);
+})(i);
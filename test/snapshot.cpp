@@ -0,0 +1,291 @@
+// DomSnapshot::Decode against output built the way the page-side walker
+// builds it, and against input it has to turn down.
+
+#include "snapshot.h"
+#include "check.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace nodium;
+
+// A node as the walker sees it; parent is 1-based, 0 for the root
+struct Node
+{
+	int type;
+	uint32_t parent;
+	std::wstring name;
+	std::wstring text;
+	std::vector<std::pair<std::wstring, std::wstring> > attributes;
+};
+
+static std::wstring Base36(uint32_t value)
+{
+	std::wstring digits;
+
+	do
+	{
+		int digit = value % 36;
+		digits.insert(digits.begin(), (wchar_t)(digit < 10 ? '0' + digit : 'a' + digit - 10));
+		value /= 36;
+	} while(value);
+
+	return digits;
+}
+
+// Length as the page counts it, in UTF-16 units
+static uint32_t Utf16Length(const std::wstring& s)
+{
+	uint32_t length = 0;
+
+	for(size_t i = 0; i < s.size(); i++)
+		length += (uint32_t)s[i] >= 0x10000 ? 2 : 1;
+
+	return length;
+}
+
+// What the walker returns for the given nodes, in document order
+class Walker
+{
+public:
+	std::wstring Encode(const std::vector<Node>& nodes)
+	{
+		std::vector<uint32_t> out(3, 0);
+		uint32_t attributes = 0;
+
+		for(size_t i = 0; i < nodes.size(); i++)
+		{
+			const Node& node = nodes[i];
+
+			if(node.type == 1)
+			{
+				out.push_back(1);
+				out.push_back(node.parent);
+				out.push_back(Id(node.name));
+				out.push_back(0);
+				out.push_back((uint32_t)node.attributes.size());
+
+				for(size_t a = 0; a < node.attributes.size(); a++)
+				{
+					out.push_back(Id(node.attributes[a].first));
+					out.push_back(Id(node.attributes[a].second));
+				}
+
+				attributes += (uint32_t)node.attributes.size();
+			}
+			else
+			{
+				out.push_back(3);
+				out.push_back(node.parent);
+				out.push_back(Id(L"#text"));
+				out.push_back(Id(node.text) + 1);
+				out.push_back(0);
+			}
+		}
+
+		out[0] = (uint32_t)nodes.size();
+		out[1] = attributes;
+		out[2] = (uint32_t)strings.size();
+
+		for(size_t i = 0; i < strings.size(); i++)
+			out.push_back(Utf16Length(strings[i]));
+
+		std::wstring encoded;
+
+		for(size_t i = 0; i < out.size(); i++)
+			encoded += (i ? L"," : L"") + Base36(out[i]);
+
+		encoded += L'|';
+
+		for(size_t i = 0; i < strings.size(); i++)
+			encoded += strings[i];
+
+		return encoded;
+	}
+
+private:
+	uint32_t Id(const std::wstring& s)
+	{
+		std::map<std::wstring, uint32_t>::iterator it = ids.find(s);
+
+		if(it != ids.end())
+			return it->second;
+
+		ids[s] = (uint32_t)strings.size();
+		strings.push_back(s);
+		return (uint32_t)strings.size() - 1;
+	}
+
+	std::map<std::wstring, uint32_t> ids;
+	std::vector<std::wstring> strings;
+};
+
+static Node Element(uint32_t parent, const wchar_t* name)
+{
+	Node node;
+	node.type = 1;
+	node.parent = parent;
+	node.name = name;
+	return node;
+}
+
+static Node Text(uint32_t parent, const std::wstring& text)
+{
+	Node node;
+	node.type = 3;
+	node.parent = parent;
+	node.name = L"#text";
+	node.text = text;
+	return node;
+}
+
+static std::wstring String(const DomSnapshot& snapshot, size_t i)
+{
+	size_t length;
+	const wchar_t* str = snapshot.String(i, length);
+	return std::wstring(str, length);
+}
+
+static bool Decode(std::wstring encoded)
+{
+	DomSnapshot snapshot;
+	return snapshot.Decode(encoded);
+}
+
+// <html lang="en"><body class="a b" id="main">Hi <b>there</b>, 😀</body></html>
+static std::vector<Node> Document()
+{
+	std::vector<Node> nodes;
+	std::wstring smiley;
+
+#if defined(NODIUM_WIDE_UTF32)
+	smiley += (wchar_t)0x1F600;
+#else
+	smiley += (wchar_t)0xD83D;
+	smiley += (wchar_t)0xDE00;
+#endif
+
+	nodes.push_back(Element(0, L"html"));
+	nodes.back().attributes.push_back(std::make_pair(L"lang", L"en"));
+	nodes.push_back(Element(1, L"body"));
+	nodes.back().attributes.push_back(std::make_pair(L"class", L"a b"));
+	nodes.back().attributes.push_back(std::make_pair(L"id", L"main"));
+	nodes.push_back(Text(2, L"Hi "));
+	nodes.push_back(Element(2, L"b"));
+	nodes.push_back(Text(4, L"there"));
+	nodes.push_back(Text(2, L", " + smiley));
+
+	// "__proto__" is just another string, and repeats share an entry
+	nodes.push_back(Element(2, L"i"));
+	nodes.back().attributes.push_back(std::make_pair(L"__proto__", L"en"));
+
+	return nodes;
+}
+
+static void TestRoundTrip()
+{
+	std::vector<Node> nodes = Document();
+	std::wstring encoded = Walker().Encode(nodes);
+
+	DomSnapshot snapshot;
+	CHECK(snapshot.Decode(encoded));
+	CHECK(snapshot.Nodes() == nodes.size());
+
+	if(snapshot.Nodes() != nodes.size())
+		return;
+
+	uint32_t attribute = 0;
+
+	for(size_t i = 0; i < nodes.size(); i++)
+	{
+		CHECK(snapshot.Types()[i] == nodes[i].type);
+		CHECK(snapshot.Parents()[i] == (int32_t)nodes[i].parent - 1);
+		CHECK(String(snapshot, snapshot.Names()[i]) == nodes[i].name);
+
+		if(nodes[i].type == 3)
+			CHECK(snapshot.Texts()[i] >= 0 && String(snapshot, snapshot.Texts()[i]) == nodes[i].text);
+		else
+			CHECK(snapshot.Texts()[i] == -1);
+
+		CHECK(snapshot.AttributeStart()[i] == attribute);
+
+		for(size_t a = 0; a < nodes[i].attributes.size(); a++, attribute++)
+		{
+			CHECK(String(snapshot, snapshot.AttributeNames()[attribute]) == nodes[i].attributes[a].first);
+			CHECK(String(snapshot, snapshot.AttributeValues()[attribute]) == nodes[i].attributes[a].second);
+		}
+	}
+
+	CHECK(snapshot.AttributeStart()[nodes.size()] == attribute);
+	CHECK(snapshot.AttributeNames().size() == attribute);
+
+	// "en" once, "#text" once
+	CHECK(snapshot.Strings() == 15);
+
+	// a page with no document element
+	DomSnapshot empty;
+	std::wstring nothing = L"0,0,0|";
+	CHECK(empty.Decode(nothing));
+	CHECK(empty.Nodes() == 0 && empty.AttributeStart().size() == 1);
+}
+
+static void TestMalformed()
+{
+	std::wstring encoded = Walker().Encode(Document());
+	size_t bar = encoded.find(L'|');
+
+	// every truncation of the integers or the strings
+	for(size_t length = 0; length < encoded.size(); length++)
+		CHECK(!Decode(encoded.substr(0, length)));
+
+	CHECK(!Decode(encoded + L"x"));
+	CHECK(!Decode(encoded.substr(0, bar) + L"," + encoded.substr(bar)));
+	CHECK(!Decode(L""));
+	CHECK(!Decode(L"|"));
+	CHECK(!Decode(L"0,0,0"));
+	CHECK(!Decode(L"0,,0,0|"));
+	CHECK(!Decode(L"0,0,0,|"));
+	CHECK(!Decode(L"0,0,A|"));
+	CHECK(!Decode(L"-1,0,0|"));
+
+	// types other than element and text, a root with a parent, a second
+	// root, a parent that comes later and an index past the string table
+	CHECK(!Decode(L"1,0,1,2,0,0,0,0,1|a"));
+	CHECK(!Decode(L"1,0,1,1,1,0,0,0,1|a"));
+	CHECK(!Decode(L"2,0,1,1,0,0,0,0,1,0,0,0,0,1|a"));
+	CHECK(!Decode(L"2,0,1,1,0,0,0,0,1,3,0,0,0,1|a"));
+	CHECK(!Decode(L"1,0,1,1,0,1,0,0,1|a"));
+	CHECK(!Decode(L"1,0,1,3,0,0,2,0,1|a"));
+	CHECK(Decode(L"1,0,1,1,0,0,0,0,1|a"));
+
+	// more attributes than declared, or fewer
+	CHECK(!Decode(L"1,0,1,1,0,0,0,1,0,0,1|a"));
+	CHECK(!Decode(L"1,1,1,1,0,0,0,0,1|a"));
+	CHECK(Decode(L"1,1,1,1,0,0,0,1,0,0,1|a"));
+
+	// string lengths that run past the end or leave some over
+	CHECK(!Decode(L"1,0,1,1,0,0,0,0,2|a"));
+	CHECK(!Decode(L"1,0,1,1,0,0,0,0,1|ab"));
+
+	// counts no input could back are turned down before anything is sized
+	CHECK(!Decode(L"zzzzzzzzz,0,0|"));
+	CHECK(!Decode(L"0,0,2gosa7|"));
+	CHECK(!Decode(L"1000000,0,0|"));
+	CHECK(!Decode(L"0,1000000,0|"));
+	CHECK(!Decode(L"0,0,1000000|"));
+
+#if defined(NODIUM_WIDE_UTF32)
+	// a length that would end inside a surrogate pair
+	CHECK(Decode(L"1,0,2,1,0,0,0,0,1,2|a" + std::wstring(1, (wchar_t)0x1F600)));
+	CHECK(!Decode(L"1,0,2,1,0,0,0,0,1,1|a" + std::wstring(1, (wchar_t)0x1F600)));
+#endif
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestMalformed();
+
+	return Finish("snapshot");
+}
@@ -0,0 +1,185 @@
+// Round trips through the transcoding kernels in utf.cpp, at lengths and
+// offsets that land on both the vector paths and their scalar tails.
+
+#include "utf.h"
+#include "check.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace nodium;
+
+// Scalar values in four flavours: ASCII, Latin-1, CJK and astral
+static std::wstring MakeText(size_t length, int seed)
+{
+	std::wstring text;
+	srand(seed);
+
+	while(text.size() < length)
+	{
+		uint32_t c;
+
+		switch(rand() % 4)
+		{
+		case 0:
+			c = ' ' + rand() % 95;
+			break;
+		case 1:
+			c = 0xA0 + rand() % 0x60;
+			break;
+		case 2:
+			c = 0x4E00 + rand() % 0x5000;
+			break;
+		default:
+			c = 0x1F300 + rand() % 0x300;
+			break;
+		}
+
+		// a run of ASCII every so often so the fast paths get a go
+		if(rand() % 3 == 0)
+		{
+			for(int i = rand() % 40; i > 0; i--)
+				text.push_back((wchar_t)('a' + i % 26));
+		}
+
+#if defined(NODIUM_WIDE_UTF32)
+		text.push_back((wchar_t)c);
+#else
+		if(c >= 0x10000)
+		{
+			text.push_back((wchar_t)(0xD800 + ((c - 0x10000) >> 10)));
+			text.push_back((wchar_t)(0xDC00 + ((c - 0x10000) & 0x3FF)));
+		}
+		else
+			text.push_back((wchar_t)c);
+#endif
+	}
+
+	return text;
+}
+
+static std::wstring Utf8RoundTrip(const std::wstring& text)
+{
+	std::vector<char> utf8(4 * text.size() + 1);
+	size_t bytes = WideToUtf8(text.data(), text.size(), &utf8[0]);
+
+	std::vector<wchar_t> wide(bytes + 1);
+	size_t units = Utf8ToWide(&utf8[0], bytes, &wide[0]);
+
+	return std::wstring(&wide[0], units);
+}
+
+static std::wstring Utf16RoundTrip(const std::wstring& text)
+{
+	std::vector<uint16_t> utf16(2 * text.size() + 1);
+	size_t units = WideToUtf16(text.data(), text.size(), &utf16[0]);
+
+	std::vector<wchar_t> wide(units + 1);
+	size_t count = Utf16ToWide(&utf16[0], units, &wide[0]);
+
+	return std::wstring(&wide[0], count);
+}
+
+static std::wstring DecodeUtf8(const char* src)
+{
+	size_t length = strlen(src);
+	std::vector<wchar_t> wide(length + 1);
+
+	return std::wstring(&wide[0], Utf8ToWide(src, length, &wide[0]));
+}
+
+static void TestRoundTrips()
+{
+	for(size_t length = 0; length < 200; length++)
+	{
+		std::wstring text = MakeText(length, (int)length + 1);
+
+		// every start offset within a vector, so loads are misaligned too
+		for(size_t offset = 0; offset < 16 && offset <= text.size(); offset++)
+		{
+			std::wstring part = text.substr(offset);
+
+			CHECK(Utf8RoundTrip(part) == part);
+			CHECK(Utf16RoundTrip(part) == part);
+		}
+	}
+
+	std::wstring large = MakeText(100000, 7);
+	CHECK(Utf8RoundTrip(large) == large);
+	CHECK(Utf16RoundTrip(large) == large);
+}
+
+static void TestKnownEncodings()
+{
+	// U+00E9, U+20AC and U+1F600
+	CHECK(DecodeUtf8("a\xC3\xA9\xE2\x82\xAC") == L"a\x00E9\x20AC");
+
+	std::wstring smiley = DecodeUtf8("\xF0\x9F\x98\x80");
+#if defined(NODIUM_WIDE_UTF32)
+	CHECK(smiley.size() == 1 && (uint32_t)smiley[0] == 0x1F600);
+#else
+	CHECK(smiley.size() == 2 && smiley[0] == 0xD83D && smiley[1] == 0xDE00);
+#endif
+
+	uint16_t utf16[4];
+	CHECK(WideToUtf16(smiley.data(), smiley.size(), utf16) == 2);
+	CHECK(utf16[0] == 0xD83D && utf16[1] == 0xDE00);
+}
+
+static void TestMalformedUtf8()
+{
+	// lone continuation, invalid lead, overlong, surrogate, beyond U+10FFFF
+	// and truncated sequences each become one U+FFFD
+	CHECK(DecodeUtf8("\x80") == L"\xFFFD");
+	CHECK(DecodeUtf8("a\xFF" "b") == L"a\xFFFD" L"b");
+	CHECK(DecodeUtf8("\xC0\x80") == L"\xFFFD");
+	CHECK(DecodeUtf8("\xE0\x80\x80") == L"\xFFFD");
+	CHECK(DecodeUtf8("\xED\xA0\x80") == L"\xFFFD");
+	CHECK(DecodeUtf8("\xF4\x90\x80\x80") == L"\xFFFD");
+	CHECK(DecodeUtf8("\xE2\x82") == L"\xFFFD");
+	CHECK(DecodeUtf8("\xE2\x82" "a") == L"\xFFFD" L"a");
+}
+
+static void TestLoneSurrogates()
+{
+	wchar_t lone[3] = { 'a', (wchar_t)0xD800, 'b' };
+
+	// kept on the way to and from UTF-16, as JS strings allow them
+	uint16_t utf16[6];
+	CHECK(WideToUtf16(lone, 3, utf16) == 3);
+	CHECK(utf16[1] == 0xD800);
+
+	wchar_t wide[3];
+	CHECK(Utf16ToWide(utf16, 3, wide) == 3);
+	CHECK(memcmp(wide, lone, sizeof(lone)) == 0);
+
+	// but UTF-8 cannot carry them
+	char utf8[12];
+	CHECK(WideToUtf8(lone, 3, utf8) == 5);
+	CHECK(memcmp(utf8, "a\xEF\xBF\xBD" "b", 5) == 0);
+}
+
+static void TestAscii()
+{
+	char narrow[64];
+	std::wstring text(40, L'x');
+
+	CHECK(WideToAscii(text.data(), text.size(), narrow) == 40);
+	CHECK(memcmp(narrow, std::string(40, 'x').data(), 40) == 0);
+
+	text[33] = (wchar_t)0xE9;
+	CHECK(WideToAscii(text.data(), text.size(), narrow) == 33);
+}
+
+int main()
+{
+	TestRoundTrips();
+	TestKnownEncodings();
+	TestMalformedUtf8();
+	TestLoneSurrogates();
+	TestAscii();
+
+	return Finish("utf");
+}
@@ -0,0 +1,137 @@
+#include "thumbnail.h"
+#include "jpeg.h"
+#include "buffer.h"
+#include "pool.h"
+
+#include <string.h>
+
+using namespace v8;
+
+#define DEFAULT_QUALITY 80
+
+namespace nodium {
+
+Thumbnails::Thumbnails()
+	: filter(SCALE_AREA), quality(DEFAULT_QUALITY)
+{
+}
+
+static int Dimension(Local<Object> size, const char* name)
+{
+	Local<Value> value = size->Get(String::NewSymbol(name));
+	return value->IsNumber() ? value->Int32Value() : 0;
+}
+
+bool Thumbnails::Parse(Handle<Value> list, Handle<Value> name, const char*& error)
+{
+	HandleScope scope;
+
+	if(!list->IsArray())
+	{
+		error = "thumbnails expects an array of sizes";
+		return false;
+	}
+
+	Handle<Array> array = Handle<Array>::Cast(list);
+
+	sizes.clear();
+
+	for(uint32_t i = 0; i < array->Length(); i++)
+	{
+		Local<Value> item = array->Get(i);
+		int width = 0;
+		int height = 0;
+
+		if(item->IsNumber())
+			width = item->Int32Value();
+		else if(item->IsObject())
+		{
+			width = Dimension(item->ToObject(), "width");
+			height = Dimension(item->ToObject(), "height");
+		}
+
+		if(width < 0 || height < 0 || (width == 0 && height == 0))
+		{
+			error = "Thumbnail sizes need a positive width or height";
+			return false;
+		}
+
+		sizes.push_back(std::make_pair(width, height));
+	}
+
+	if(!name->IsUndefined())
+	{
+		String::Utf8Value utf8(name);
+
+		if(strcmp(*utf8, "area") == 0)
+			filter = SCALE_AREA;
+		else if(strcmp(*utf8, "lanczos") == 0)
+			filter = SCALE_LANCZOS;
+		else
+		{
+			error = "filter must be \"area\" or \"lanczos\"";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int Clamp(int value, int limit)
+{
+	if(value < 1)
+		return 1;
+
+	return value > limit ? limit : value;
+}
+
+bool Thumbnails::Encode(const unsigned char* bgra, int width, int height, int rowSpan,
+						std::vector<std::string>& out) const
+{
+	std::vector<ScaleTarget> targets(sizes.size());
+	bool ok = true;
+
+	for(size_t i = 0; i < sizes.size(); i++)
+	{
+		int w = sizes[i].first;
+		int h = sizes[i].second;
+
+		if(w == 0)
+			w = (int)((double)h * width / height + 0.5);
+		else if(h == 0)
+			h = (int)((double)w * height / width + 0.5);
+
+		targets[i].width = Clamp(w, width);
+		targets[i].height = Clamp(h, height);
+		targets[i].pixels = PixelPool::Acquire((size_t)targets[i].width * targets[i].height * 4);
+		ok = ok && targets[i].pixels != NULL;
+	}
+
+	ok = ok && Downscale(bgra, width, height, rowSpan, filter, targets);
+	out.resize(targets.size());
+
+	for(size_t i = 0; i < targets.size(); i++)
+	{
+		out[i].clear();
+
+		ok = ok && EncodeJpeg(targets[i].pixels, targets[i].width, targets[i].height,
+							  targets[i].width * 4, quality, out[i]);
+
+		PixelPool::Release(targets[i].pixels);
+	}
+
+	return ok;
+}
+
+Local<Array> Thumbnails::ToV8(const std::vector<std::string>& encoded)
+{
+	HandleScope scope;
+	Local<Array> result = Array::New((int)encoded.size());
+
+	for(size_t i = 0; i < encoded.size(); i++)
+		result->Set((uint32_t)i, NewBuffer(encoded[i].data(), encoded[i].size()));
+
+	return scope.Close(result);
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef NODIUM_THUMBNAIL_H
+#define NODIUM_THUMBNAIL_H
+
+#include <v8.h>
+#include <string>
+#include <vector>
+#include "scale.h"
+
+namespace nodium {
+
+// A set of JPEG thumbnail sizes made from one render. Sizes come from JS as
+// [256, { width: 320, height: 240 }, { height: 100 }, ...]: a bare number is
+// a width, and a missing dimension follows the aspect ratio of the render.
+// Nothing is scaled up past the render itself.
+struct Thumbnails
+{
+	std::vector<std::pair<int, int> > sizes;
+	ScaleFilter filter;
+	int quality;
+
+	Thumbnails();
+
+	// Fills in sizes and filter ("area" or "lanczos") from JS values; on bad
+	// input returns false with error set
+	bool Parse(v8::Handle<v8::Value> sizes, v8::Handle<v8::Value> filter, const char*& error);
+
+	// Resamples every size in one pass over the pixels, then encodes each
+	// straight from the resampled buffer. Safe on worker threads.
+	bool Encode(const unsigned char* bgra, int width, int height, int rowSpan,
+				std::vector<std::string>& out) const;
+
+	// Array of Buffers, in the order the sizes were given
+	static v8::Local<v8::Array> ToV8(const std::vector<std::string>& encoded);
+};
+
+}
+
+#endif
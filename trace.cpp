@@ -0,0 +1,248 @@
+#include "trace.h"
+
+#include <uv.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// A forgotten trace must not grow without bound
+#define MAX_TRACE_EVENTS 100000
+
+namespace nodium {
+
+Trace::Trace()
+	: enabled(false), viewId(0), dropped(0)
+{
+	pthread_mutex_init(&lock, NULL);
+}
+
+Trace::~Trace()
+{
+	pthread_mutex_destroy(&lock);
+}
+
+uint64_t Trace::Now()
+{
+	return uv_hrtime() / 1000;
+}
+
+void Trace::Start(unsigned id)
+{
+	pthread_mutex_lock(&lock);
+
+	events.clear();
+	requests.clear();
+	dropped = 0;
+	viewId = id;
+	enabled = true;
+
+	pthread_mutex_unlock(&lock);
+}
+
+bool Trace::Stop(std::string& out)
+{
+	pthread_mutex_lock(&lock);
+
+	if(!enabled)
+	{
+		pthread_mutex_unlock(&lock);
+		return false;
+	}
+
+	enabled = false;
+
+	char meta[256];
+	snprintf(meta, sizeof(meta),
+			 "{\"traceEvents\":[{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+			 "\"tid\":%u,\"args\":{\"name\":\"WebView %u\"}}",
+			 (int)getpid(), viewId, viewId);
+	out += meta;
+
+	for(size_t i = 0; i < events.size(); i++)
+	{
+		out += ',';
+		out += events[i];
+	}
+
+	snprintf(meta, sizeof(meta),
+			 "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%lu}}",
+			 (unsigned long)dropped);
+	out += meta;
+
+	events.clear();
+	requests.clear();
+
+	pthread_mutex_unlock(&lock);
+
+	return true;
+}
+
+void Trace::Quote(const std::string& value, std::string& out)
+{
+	out += '"';
+
+	for(size_t i = 0; i < value.size(); i++)
+	{
+		unsigned char c = (unsigned char)value[i];
+
+		switch(c)
+		{
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if(c < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out += escaped;
+			}
+			else
+				out += (char)c;
+		}
+	}
+
+	out += '"';
+}
+
+// Called with the lock held
+void Trace::Append(const char* name, const char* category, char phase,
+				   uint64_t ts, uint64_t duration, const std::string& args)
+{
+	if(events.size() >= MAX_TRACE_EVENTS)
+	{
+		dropped++;
+		return;
+	}
+
+	char head[256];
+
+	if(phase == 'X')
+		snprintf(head, sizeof(head),
+				 "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,"
+				 "\"pid\":%d,\"tid\":%u", name, category, (unsigned long long)ts,
+				 (unsigned long long)duration, (int)getpid(), viewId);
+	else
+		snprintf(head, sizeof(head),
+				 "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,"
+				 "\"pid\":%d,\"tid\":%u", name, category, (unsigned long long)ts,
+				 (int)getpid(), viewId);
+
+	events.push_back(head);
+
+	std::string& event = events.back();
+
+	if(!args.empty())
+	{
+		event += ",\"args\":{";
+		event += args;
+		event += '}';
+	}
+
+	event += '}';
+}
+
+void Trace::Instant(const char* name, const char* category)
+{
+	if(!enabled)
+		return;
+
+	uint64_t now = Now();
+
+	pthread_mutex_lock(&lock);
+
+	if(enabled)
+		Append(name, category, 'i', now, 0, std::string());
+
+	pthread_mutex_unlock(&lock);
+}
+
+void Trace::Instant(const char* name, const char* category, const char* key,
+					const std::string& value)
+{
+	if(!enabled)
+		return;
+
+	uint64_t now = Now();
+	std::string args;
+
+	Quote(key, args);
+	args += ':';
+	Quote(value, args);
+
+	pthread_mutex_lock(&lock);
+
+	if(enabled)
+		Append(name, category, 'i', now, 0, args);
+
+	pthread_mutex_unlock(&lock);
+}
+
+void Trace::Complete(const char* name, const char* category, uint64_t start,
+					 uint64_t end, const std::string& args)
+{
+	if(!enabled)
+		return;
+
+	pthread_mutex_lock(&lock);
+
+	if(enabled)
+		Append(name, category, 'X', start, end > start ? end - start : 0, args);
+
+	pthread_mutex_unlock(&lock);
+}
+
+void Trace::Request(const std::string& url)
+{
+	if(!enabled)
+		return;
+
+	uint64_t now = Now();
+
+	pthread_mutex_lock(&lock);
+
+	if(enabled)
+		requests.insert(std::make_pair(url, now));
+
+	pthread_mutex_unlock(&lock);
+}
+
+void Trace::Response(const std::string& url, int statusCode, bool cached,
+					 int64_t expectedSize, const std::string& mimeType)
+{
+	if(!enabled)
+		return;
+
+	uint64_t now = Now();
+	std::string args;
+	char numbers[128];
+
+	args += "\"url\":";
+	Quote(url, args);
+	snprintf(numbers, sizeof(numbers), ",\"status\":%d,\"cached\":%s,\"expectedSize\":%lld,",
+			 statusCode, cached ? "true" : "false", (long long)expectedSize);
+	args += numbers;
+	args += "\"mimeType\":";
+	Quote(mimeType, args);
+
+	pthread_mutex_lock(&lock);
+
+	if(enabled)
+	{
+		// the oldest open request for the URL is the one being answered
+		OpenRequests::iterator it = requests.find(url);
+
+		if(it != requests.end())
+		{
+			Append("resource", "network", 'X', it->second, now - it->second, args);
+			requests.erase(it);
+		}
+		else
+			Append("resource", "network", 'i', now, 0, args);
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef NODIUM_TRACE_H
+#define NODIUM_TRACE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+// Timeline of one view in Chrome trace-event format, viewable in
+// chrome://tracing. Listener callbacks become instant events, interceptor
+// request/response pairs and the binding's own work become complete
+// events. Interceptor callbacks may arrive off the main thread, so every
+// entry point takes the lock; when tracing is off they return right away.
+class Trace
+{
+public:
+	Trace();
+	~Trace();
+
+	// Starts a fresh timeline, dropping anything recorded before
+	void Start(unsigned viewId);
+
+	// Stops recording and appends the trace JSON to out. Returns false if
+	// tracing was not on.
+	bool Stop(std::string& out);
+
+	bool Enabled() const { return enabled; }
+
+	// Monotonic microseconds, the trace's time base
+	static uint64_t Now();
+
+	void Instant(const char* name, const char* category);
+	void Instant(const char* name, const char* category, const char* key,
+				 const std::string& value);
+	void Complete(const char* name, const char* category, uint64_t start,
+				  uint64_t end, const std::string& args = std::string());
+
+	void Request(const std::string& url);
+	void Response(const std::string& url, int statusCode, bool cached,
+				  int64_t expectedSize, const std::string& mimeType);
+
+	// Appends value as a quoted JSON string
+	static void Quote(const std::string& value, std::string& out);
+
+private:
+	void Append(const char* name, const char* category, char phase,
+				uint64_t ts, uint64_t duration, const std::string& args);
+
+	typedef std::multimap<std::string, uint64_t> OpenRequests;
+
+	pthread_mutex_t lock;
+	volatile bool enabled;
+	unsigned viewId;
+	size_t dropped;
+	std::vector<std::string> events;
+	OpenRequests requests;
+};
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "transcode.h"
+#include "utf.h"
+
+#include <vector>
+
+using namespace v8;
+
+// Scratch space is kept between calls, but handed back once a single huge
+// string has blown it up past this size
+#define SCRATCH_RETAIN_BYTES (1024 * 1024)
+
+namespace nodium {
+
+static std::vector<uint16_t> utf16Scratch;
+static std::vector<char> asciiScratch;
+
+template <typename T>
+static T* Reserve(std::vector<T>& scratch, size_t units)
+{
+	if(scratch.size() < units)
+		scratch.resize(units);
+
+	return &scratch[0];
+}
+
+template <typename T>
+static void Release(std::vector<T>& scratch)
+{
+	if(scratch.size() * sizeof(T) > SCRATCH_RETAIN_BYTES)
+		std::vector<T>().swap(scratch);
+}
+
+void ToWide(Handle<Value> value, std::wstring& out)
+{
+	HandleScope scope;
+
+	Local<String> str = value->ToString();
+	int length = str->Length();
+
+	if(length == 0)
+	{
+		out.clear();
+		return;
+	}
+
+	uint16_t* utf16 = Reserve(utf16Scratch, length);
+	str->Write(utf16, 0, length);
+
+	out.resize(length);
+	out.resize(Utf16ToWide(utf16, length, &out[0]));
+
+	Release(utf16Scratch);
+}
+
+std::wstring ToWide(Handle<Value> value)
+{
+	std::wstring result;
+	ToWide(value, result);
+	return result;
+}
+
+std::wstring WidenUtf8(const char* data, size_t length)
+{
+	std::wstring result;
+
+	if(length > 0)
+	{
+		result.resize(length);
+		result.resize(Utf8ToWide(data, length, &result[0]));
+	}
+
+	return result;
+}
+
+void EncodeUtf8(const wchar_t* src, size_t length, std::string& out)
+{
+	if(length == 0)
+		return;
+
+	size_t start = out.size();
+	out.resize(start + length * 4);
+	out.resize(start + WideToUtf8(src, length, &out[start]));
+}
+
+Local<String> ToV8(const wchar_t* str, size_t length)
+{
+	if(length == 0)
+		return String::Empty();
+
+	char* ascii = Reserve(asciiScratch, length);
+
+	if(WideToAscii(str, length, ascii) == length)
+	{
+		Local<String> result = String::New(ascii, (int)length);
+		Release(asciiScratch);
+		return result;
+	}
+
+	uint16_t* utf16 = Reserve(utf16Scratch, length * 2);
+	Local<String> result = String::New(utf16, (int)WideToUtf16(str, length, utf16));
+
+	Release(asciiScratch);
+	Release(utf16Scratch);
+
+	return result;
+}
+
+Local<String> ToV8(const std::wstring& str)
+{
+	return ToV8(str.data(), str.size());
+}
+
+Local<String> ToV8(const std::string& str)
+{
+	return String::New(str.data(), (int)str.size());
+}
+
+}
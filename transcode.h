@@ -0,0 +1,27 @@
+#ifndef NODIUM_TRANSCODE_H
+#define NODIUM_TRANSCODE_H
+
+#include <v8.h>
+#include <string>
+
+namespace nodium {
+
+// Awesomium speaks std::wstring (UTF-32 on Linux and OS X) while V8 speaks
+// UTF-16; these helpers convert between the two on top of the kernels in
+// utf.h. They share scratch buffers, so call them from the main thread only.
+
+std::wstring ToWide(v8::Handle<v8::Value> value);
+void ToWide(v8::Handle<v8::Value> value, std::wstring& out);
+std::wstring WidenUtf8(const char* data, size_t length);
+
+// Appends the UTF-8 encoding of src to out.
+void EncodeUtf8(const wchar_t* src, size_t length, std::string& out);
+
+// Pure ASCII input becomes a compact one-byte V8 string.
+v8::Local<v8::String> ToV8(const wchar_t* str, size_t length);
+v8::Local<v8::String> ToV8(const std::wstring& str);
+v8::Local<v8::String> ToV8(const std::string& str);
+
+}
+
+#endif
@@ -0,0 +1,244 @@
+#include "userscripts.h"
+#include "core.h"
+#include "transcode.h"
+
+#include <node.h>
+
+using namespace v8;
+
+namespace nodium {
+
+UserScripts::Registry UserScripts::registry;
+std::vector<std::pair<std::string, std::string> > UserScripts::globalStyles;
+
+void UserScripts::Init(Handle<Object> target)
+{
+	NODE_SET_METHOD(target, "defineUserScript", DefineScript);
+	NODE_SET_METHOD(target, "defineUserStyle", DefineStyle);
+	NODE_SET_METHOD(target, "removeUserScript", Remove);
+}
+
+UserScript* UserScripts::Acquire(const std::string& name)
+{
+	Registry::iterator it = registry.find(name);
+
+	if(it == registry.end())
+		return NULL;
+
+	it->second->refs++;
+	return it->second;
+}
+
+void UserScripts::Release(UserScript* script)
+{
+	if(--script->refs == 0)
+		delete script;
+}
+
+void UserScripts::AppendGlobalCSS(std::string& css)
+{
+	for(size_t i = 0; i < globalStyles.size(); i++)
+	{
+		if(!css.empty())
+			css += '\n';
+
+		css += globalStyles[i].second;
+	}
+}
+
+static bool RemoveGlobal(std::vector<std::pair<std::string, std::string> >& styles,
+						 const std::string& name)
+{
+	for(size_t i = 0; i < styles.size(); i++)
+	{
+		if(styles[i].first == name)
+		{
+			styles.erase(styles.begin() + i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Takes over the registry's reference to script; NULL only removes
+void UserScripts::Define(const std::string& name, UserScript* script)
+{
+	Registry::iterator it = registry.find(name);
+
+	if(it != registry.end())
+	{
+		Release(it->second);
+		registry.erase(it);
+	}
+
+	RemoveGlobal(globalStyles, name);
+
+	if(script != NULL)
+		registry[name] = script;
+}
+
+static std::string Utf8(Handle<Value> value)
+{
+	String::Utf8Value utf8(value);
+	return std::string(*utf8, utf8.length());
+}
+
+// The body of a single-quoted JS string holding text
+static void AppendQuoted(std::wstring& out, const std::wstring& text)
+{
+	out.reserve(out.size() + text.size() + text.size() / 8 + 16);
+
+	for(size_t i = 0; i < text.size(); i++)
+	{
+		wchar_t c = text[i];
+
+		switch(c)
+		{
+		case '\\': out += L"\\\\"; break;
+		case '\'': out += L"\\'"; break;
+		case '\n': out += L"\\n"; break;
+		case '\r': out += L"\\r"; break;
+		case 0x2028: out += L"\\u2028"; break;
+		case 0x2029: out += L"\\u2029"; break;
+		default: out += c;
+		}
+	}
+}
+
+// defineUserScript(name, source) runs source at global scope in every
+// main-frame document of the views that use name
+Handle<Value> UserScripts::DefineScript(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!args[0]->IsString() || !args[1]->IsString())
+		return ThrowException(Exception::TypeError(
+			String::New("defineUserScript expects a name and the script source")));
+
+	std::string name = Utf8(args[0]);
+	UserScript* script = new UserScript();
+	script->refs = 1;
+
+	ToWide(args[1], script->injection);
+
+	// names the script in console messages and stack traces
+	script->injection += L"\n//@ sourceURL=nodium-user-script/";
+	script->injection += WidenUtf8(name.data(), name.size());
+
+	Define(name, script);
+
+	return Undefined();
+}
+
+// defineUserStyle(name, css, [{ global }]) adds css to every main-frame
+// document of the views that use name, or with global to every document
+// of every view
+Handle<Value> UserScripts::DefineStyle(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!args[0]->IsString() || !args[1]->IsString())
+		return ThrowException(Exception::TypeError(
+			String::New("defineUserStyle expects a name and the stylesheet")));
+
+	bool global = args[2]->IsObject() &&
+		args[2]->ToObject()->Get(String::NewSymbol("global"))->BooleanValue();
+
+	if(global && Core::Created())
+		return ThrowException(Exception::Error(
+			String::New("Global styles must be defined before the first WebView is created")));
+
+	std::string name = Utf8(args[0]);
+
+	if(global)
+	{
+		Define(name, NULL);
+		globalStyles.push_back(std::make_pair(name, Utf8(args[1])));
+		return Undefined();
+	}
+
+	std::wstring css;
+	ToWide(args[1], css);
+
+	UserScript* script = new UserScript();
+	script->refs = 1;
+
+	// the parser may not have created the root element yet when this runs
+	script->injection = L"(function(){var css='";
+	AppendQuoted(script->injection, css);
+	script->injection +=
+		L"';function add(){var s=document.createElement('style');s.textContent=css;"
+		L"(document.head||document.documentElement).appendChild(s);}"
+		L"if(document.documentElement)add();"
+		L"else document.addEventListener('DOMContentLoaded',add,false);})()";
+
+	Define(name, script);
+
+	return Undefined();
+}
+
+// removeUserScript(name) returns whether there was such a script or style
+Handle<Value> UserScripts::Remove(const Arguments& args)
+{
+	HandleScope scope;
+
+	std::string name = Utf8(args[0]);
+	bool found = registry.count(name) > 0 || RemoveGlobal(globalStyles, name);
+
+	Define(name, NULL);
+
+	return scope.Close(Boolean::New(found));
+}
+
+bool UserScriptSet::Assign(Handle<Value> names, std::string& error)
+{
+	HandleScope scope;
+
+	if(!names->IsArray())
+	{
+		error = "User scripts must be an array of names";
+		return false;
+	}
+
+	Handle<Array> list = Handle<Array>::Cast(names);
+	std::vector<UserScript*> acquired;
+
+	for(uint32_t i = 0; i < list->Length(); i++)
+	{
+		std::string name = Utf8(list->Get(i));
+		UserScript* script = UserScripts::Acquire(name);
+
+		if(script == NULL)
+		{
+			for(size_t k = 0; k < acquired.size(); k++)
+				UserScripts::Release(acquired[k]);
+
+			error = "No user script or style named \"" + name + "\"";
+			return false;
+		}
+
+		acquired.push_back(script);
+	}
+
+	Clear();
+	scripts.swap(acquired);
+
+	return true;
+}
+
+void UserScriptSet::Clear()
+{
+	for(size_t i = 0; i < scripts.size(); i++)
+		UserScripts::Release(scripts[i]);
+
+	scripts.clear();
+}
+
+void UserScriptSet::Inject(Awesomium::WebView* webView) const
+{
+	for(size_t i = 0; i < scripts.size(); i++)
+		webView->executeJavascript(scripts[i]->injection);
+}
+
+}
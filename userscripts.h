@@ -0,0 +1,74 @@
+#ifndef NODIUM_USERSCRIPTS_H
+#define NODIUM_USERSCRIPTS_H
+
+#include <v8.h>
+#include <Awesomium/WebView.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+// A named script or stylesheet, converted once into the text handed to
+// executeJavascript and shared by every view that uses it. Redefining or
+// removing a name leaves views that already hold the old one untouched.
+struct UserScript
+{
+	std::wstring injection;
+	int refs;
+};
+
+// Process-wide registry behind defineUserScript(), defineUserStyle() and
+// removeUserScript(). Global styles never become UserScripts: they are
+// folded into WebCoreConfig::setCustomCSS when the WebCore is created and
+// so apply to every document from its first style resolution.
+class UserScripts
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+	// Adds a reference to the named entry; NULL if there is none
+	static UserScript* Acquire(const std::string& name);
+	static void Release(UserScript* script);
+
+	// Appends the global styles, in definition order, to css
+	static void AppendGlobalCSS(std::string& css);
+
+private:
+	static v8::Handle<v8::Value> DefineScript(const v8::Arguments& args);
+	static v8::Handle<v8::Value> DefineStyle(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Remove(const v8::Arguments& args);
+
+	static void Define(const std::string& name, UserScript* script);
+
+	typedef std::map<std::string, UserScript*> Registry;
+	static Registry registry;
+	static std::vector<std::pair<std::string, std::string> > globalStyles;
+};
+
+// The entries one view injects into each main-frame document, in order.
+class UserScriptSet
+{
+public:
+	UserScriptSet() {}
+	~UserScriptSet() { Clear(); }
+
+	// Replaces the set with the named entries. On an unknown name the set
+	// is left alone and error is set.
+	bool Assign(v8::Handle<v8::Value> names, std::string& error);
+
+	void Clear();
+	bool Empty() const { return scripts.empty(); }
+
+	void Inject(Awesomium::WebView* webView) const;
+
+private:
+	UserScriptSet(const UserScriptSet&);
+	UserScriptSet& operator=(const UserScriptSet&);
+
+	std::vector<UserScript*> scripts;
+};
+
+}
+
+#endif
@@ -0,0 +1,370 @@
+#include "utf.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+namespace nodium {
+
+static inline bool IsSurrogate(uint32_t c)
+{
+	return c >= 0xD800 && c <= 0xDFFF;
+}
+
+// End of the block of the given size starting at i, clamped to length
+static inline size_t BlockEnd(size_t i, size_t block, size_t length)
+{
+	return i + block < length ? i + block : length;
+}
+
+#if defined(__SSE2__) && defined(NODIUM_WIDE_UTF32)
+
+// True when all sixteen UTF-32 units starting at src are ASCII
+static inline bool LoadAscii16(const wchar_t* src, __m128i& a, __m128i& b,
+							   __m128i& c, __m128i& d)
+{
+	const __m128i* in = (const __m128i*)src;
+	a = _mm_loadu_si128(in);
+	b = _mm_loadu_si128(in + 1);
+	c = _mm_loadu_si128(in + 2);
+	d = _mm_loadu_si128(in + 3);
+
+	__m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+	__m128i high = _mm_and_si128(any, _mm_set1_epi32(~0x7F));
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) == 0xFFFF;
+}
+
+static inline __m128i NarrowAscii16(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+	return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+#endif
+
+size_t Utf16ToWide(const uint16_t* src, size_t length, wchar_t* dest)
+{
+#if !defined(NODIUM_WIDE_UTF32)
+	memcpy(dest, src, length * sizeof(wchar_t));
+	return length;
+#else
+	size_t i = 0;
+	size_t out = 0;
+
+	while(i < length)
+	{
+#if defined(__SSE2__)
+		const __m128i mask = _mm_set1_epi16((short)0xF800);
+		const __m128i surrogate = _mm_set1_epi16((short)0xD800);
+		const __m128i zero = _mm_setzero_si128();
+
+		// eight units per round while none of them is a surrogate
+		while(i + 8 <= length)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+
+			if(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), surrogate)))
+				break;
+
+			_mm_storeu_si128((__m128i*)(dest + out), _mm_unpacklo_epi16(v, zero));
+			_mm_storeu_si128((__m128i*)(dest + out + 4), _mm_unpackhi_epi16(v, zero));
+
+			i += 8;
+			out += 8;
+		}
+#endif
+
+		// after a miss, finish the whole block the slow way before the
+		// vector path gets another try
+		for(size_t stop = BlockEnd(i, 8, length); i < stop; )
+		{
+			uint32_t c = src[i++];
+
+			// lone surrogates are legal in JS strings; keep them so they
+			// survive the round trip back into V8
+			if(c >= 0xD800 && c <= 0xDBFF && i < length &&
+			   src[i] >= 0xDC00 && src[i] <= 0xDFFF)
+				c = 0x10000 + ((c - 0xD800) << 10) + (src[i++] - 0xDC00);
+
+			dest[out++] = (wchar_t)c;
+		}
+	}
+
+	return out;
+#endif
+}
+
+size_t WideToUtf16(const wchar_t* src, size_t length, uint16_t* dest)
+{
+#if !defined(NODIUM_WIDE_UTF32)
+	memcpy(dest, src, length * sizeof(wchar_t));
+	return length;
+#else
+	size_t i = 0;
+	size_t out = 0;
+
+	while(i < length)
+	{
+#if defined(__SSE2__)
+		const __m128i high = _mm_set1_epi32((int)0xFFFF0000);
+		const __m128i bias32 = _mm_set1_epi32(0x8000);
+		const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+		const __m128i zero = _mm_setzero_si128();
+
+		// eight units per round while all of them are in the BMP; packs is
+		// signed, so shift into its range and back
+		while(i + 8 <= length)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(
+				_mm_and_si128(_mm_or_si128(a, b), high), zero)) != 0xFFFF)
+				break;
+
+			__m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32),
+											 _mm_sub_epi32(b, bias32));
+			_mm_storeu_si128((__m128i*)(dest + out), _mm_add_epi16(packed, bias16));
+
+			i += 8;
+			out += 8;
+		}
+#endif
+
+		for(size_t stop = BlockEnd(i, 8, length); i < stop; )
+		{
+			uint32_t c = (uint32_t)src[i++];
+
+			if(c < 0x10000)
+				dest[out++] = (uint16_t)c;
+			else if(c < 0x110000)
+			{
+				c -= 0x10000;
+				dest[out++] = (uint16_t)(0xD800 + (c >> 10));
+				dest[out++] = (uint16_t)(0xDC00 + (c & 0x3FF));
+			}
+			else
+				dest[out++] = REPLACEMENT_CHARACTER;
+		}
+	}
+
+	return out;
+#endif
+}
+
+size_t Utf8ToWide(const char* src, size_t length, wchar_t* dest)
+{
+	const unsigned char* bytes = (const unsigned char*)src;
+	size_t i = 0;
+	size_t out = 0;
+
+	while(i < length)
+	{
+#if defined(__SSE2__) && defined(NODIUM_WIDE_UTF32)
+		const __m128i zero = _mm_setzero_si128();
+
+		// sixteen bytes per round while none has its high bit set
+		while(i + 16 <= length)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(bytes + i));
+
+			if(_mm_movemask_epi8(v))
+				break;
+
+			__m128i lo = _mm_unpacklo_epi8(v, zero);
+			__m128i hi = _mm_unpackhi_epi8(v, zero);
+
+			_mm_storeu_si128((__m128i*)(dest + out), _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(dest + out + 4), _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(dest + out + 8), _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128((__m128i*)(dest + out + 12), _mm_unpackhi_epi16(hi, zero));
+
+			i += 16;
+			out += 16;
+		}
+#endif
+
+		for(size_t stop = BlockEnd(i, 16, length); i < stop; )
+		{
+			uint32_t c = bytes[i];
+
+			if(c < 0x80)
+			{
+				dest[out++] = (wchar_t)c;
+				i++;
+				continue;
+			}
+
+			// well-formed two and three byte sequences skip the general
+			// decoder below. Short of the end of input, one mask tests the
+			// lead and continuation bits of a sequence together.
+			if(i + 2 < length)
+			{
+				uint32_t bits = (c << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+
+				if((bits & 0xF0C0C0) == 0xE08080)
+				{
+					uint32_t decoded = ((c & 0x0F) << 12) | ((bits >> 2) & 0xFC0) | (bits & 0x3F);
+
+					// not overlong, not a surrogate
+					if(decoded >= 0x800 && decoded - 0xD800 >= 0x800)
+					{
+						dest[out++] = (wchar_t)decoded;
+						i += 3;
+						continue;
+					}
+				}
+				else if((bits & 0xE0C000) == 0xC08000 && c >= 0xC2)
+				{
+					dest[out++] = (wchar_t)(((c & 0x1F) << 6) | ((bits >> 8) & 0x3F));
+					i += 2;
+					continue;
+				}
+			}
+
+			size_t extra;
+			uint32_t minimum;
+
+			if((c & 0xE0) == 0xC0)
+			{
+				c &= 0x1F;
+				extra = 1;
+				minimum = 0x80;
+			}
+			else if((c & 0xF0) == 0xE0)
+			{
+				c &= 0x0F;
+				extra = 2;
+				minimum = 0x800;
+			}
+			else if((c & 0xF8) == 0xF0)
+			{
+				c &= 0x07;
+				extra = 3;
+				minimum = 0x10000;
+			}
+			else
+			{
+				dest[out++] = REPLACEMENT_CHARACTER;
+				i++;
+				continue;
+			}
+
+			size_t k = 1;
+
+			for(; k <= extra && i + k < length && (bytes[i + k] & 0xC0) == 0x80; k++)
+				c = (c << 6) | (bytes[i + k] & 0x3F);
+
+			// truncated, overlong or out of range: replace what was consumed
+			i += k;
+
+			if(k <= extra || c < minimum || c > 0x10FFFF || IsSurrogate(c))
+			{
+				dest[out++] = REPLACEMENT_CHARACTER;
+				continue;
+			}
+
+#if defined(NODIUM_WIDE_UTF32)
+			dest[out++] = (wchar_t)c;
+#else
+			if(c >= 0x10000)
+			{
+				c -= 0x10000;
+				dest[out++] = (wchar_t)(0xD800 + (c >> 10));
+				dest[out++] = (wchar_t)(0xDC00 + (c & 0x3FF));
+			}
+			else
+				dest[out++] = (wchar_t)c;
+#endif
+		}
+	}
+
+	return out;
+}
+
+size_t WideToUtf8(const wchar_t* src, size_t length, char* dest)
+{
+	unsigned char* cursor = (unsigned char*)dest;
+	size_t i = 0;
+
+	while(i < length)
+	{
+#if defined(__SSE2__) && defined(NODIUM_WIDE_UTF32)
+		__m128i v0, v1, v2, v3;
+
+		while(i + 16 <= length && LoadAscii16(src + i, v0, v1, v2, v3))
+		{
+			_mm_storeu_si128((__m128i*)cursor, NarrowAscii16(v0, v1, v2, v3));
+			cursor += 16;
+			i += 16;
+		}
+#endif
+
+		for(size_t stop = BlockEnd(i, 16, length); i < stop; )
+		{
+			uint32_t c = (uint32_t)src[i++];
+
+#if !defined(NODIUM_WIDE_UTF32)
+			if(c >= 0xD800 && c <= 0xDBFF && i < length &&
+			   (uint32_t)src[i] >= 0xDC00 && (uint32_t)src[i] <= 0xDFFF)
+				c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)src[i++] - 0xDC00);
+#endif
+
+			if(c < 0x80)
+				*cursor++ = (unsigned char)c;
+			else if(c < 0x800)
+			{
+				*cursor++ = (unsigned char)(0xC0 | (c >> 6));
+				*cursor++ = (unsigned char)(0x80 | (c & 0x3F));
+			}
+			else if(c < 0x10000 && !IsSurrogate(c))
+			{
+				*cursor++ = (unsigned char)(0xE0 | (c >> 12));
+				*cursor++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+				*cursor++ = (unsigned char)(0x80 | (c & 0x3F));
+			}
+			else if(c >= 0x10000 && c < 0x110000)
+			{
+				*cursor++ = (unsigned char)(0xF0 | (c >> 18));
+				*cursor++ = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+				*cursor++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+				*cursor++ = (unsigned char)(0x80 | (c & 0x3F));
+			}
+			else
+			{
+				// UTF-8 cannot carry lone surrogates or anything beyond Unicode
+				*cursor++ = 0xEF;
+				*cursor++ = 0xBF;
+				*cursor++ = 0xBD;
+			}
+		}
+	}
+
+	return cursor - (unsigned char*)dest;
+}
+
+size_t WideToAscii(const wchar_t* src, size_t length, char* dest)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__) && defined(NODIUM_WIDE_UTF32)
+	__m128i v0, v1, v2, v3;
+
+	while(i + 16 <= length && LoadAscii16(src + i, v0, v1, v2, v3))
+	{
+		_mm_storeu_si128((__m128i*)(dest + i), NarrowAscii16(v0, v1, v2, v3));
+		i += 16;
+	}
+#endif
+
+	for(; i < length && (uint32_t)src[i] < 0x80; i++)
+		dest[i] = (char)src[i];
+
+	return i;
+}
+
+}
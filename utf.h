@@ -0,0 +1,40 @@
+#ifndef NODIUM_UTF_H
+#define NODIUM_UTF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+// wchar_t holds UTF-32 everywhere but Windows, where it holds UTF-16
+#if WCHAR_MAX > 0xFFFF
+  #define NODIUM_WIDE_UTF32 1
+#endif
+
+namespace nodium {
+
+// Transcoding kernels behind every string that crosses the binding. They
+// know nothing about V8 so they can be benchmarked on their own. Callers
+// size the destination from the bound noted on each function; the return
+// value is the number of units actually written. Malformed UTF-8, and
+// anything UTF-8 cannot encode, becomes U+FFFD rather than an error. Lone
+// surrogates survive the UTF-16 <-> UTF-32 paths so JS strings round-trip.
+
+// dest: length units
+size_t Utf16ToWide(const uint16_t* src, size_t length, wchar_t* dest);
+
+// dest: 2 * length units
+size_t WideToUtf16(const wchar_t* src, size_t length, uint16_t* dest);
+
+// dest: length units
+size_t Utf8ToWide(const char* src, size_t length, wchar_t* dest);
+
+// dest: 4 * length bytes
+size_t WideToUtf8(const wchar_t* src, size_t length, char* dest);
+
+// Narrows the leading ASCII run of src into dest (length bytes) and returns
+// its length; equal to length when src is pure ASCII.
+size_t WideToAscii(const wchar_t* src, size_t length, char* dest);
+
+}
+
+#endif
@@ -0,0 +1,1331 @@
+#include "view.h"
+#include "core.h"
+#include "transcode.h"
+#include "jsvalue.h"
+#include "buffer.h"
+#include "metrics.h"
+#include "thumbnail.h"
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace node;
+using namespace v8;
+
+#define DEFAULT_WIDTH 512
+#define DEFAULT_HEIGHT 512
+
+// How long evaluate() and snapshot() block the event loop for a result
+// when the caller names no timeout
+#define DEFAULT_EVAL_TIMEOUT_MS 30000
+
+// Console messages kept per view until drained
+#define DEFAULT_CONSOLE_ENTRIES 64
+
+// No-paint views only need a viewport for layout, never pixels
+#define NOPAINT_WIDTH 1
+#define NOPAINT_HEIGHT 1
+
+// Unwraps args.This(), waking the view up if it was paused or hibernated,
+// and bails out if the WebView was already destroyed
+#define UNWRAP_VIEW(args, view)                                              \
+	UNWRAP_VIEW_RELOAD(args, view, true)
+
+// Same, but a hibernated view is rebuilt without reloading its last URL;
+// for calls that are about to navigate anyway
+#define UNWRAP_VIEW_RELOAD(args, view, reload)                               \
+	View* view = ObjectWrap::Unwrap<View>((args).This());                    \
+	if(!view->Wake(reload))                                                  \
+		return ThrowException(Exception::Error(                              \
+			String::New("WebView has been destroyed")));
+
+#define REQUIRE_PAINT(view)                                                  \
+	if(!(view)->paint)                                                       \
+		return ThrowException(Exception::Error(                              \
+			String::New("Rendering is disabled for this WebView")));
+
+namespace nodium {
+
+Persistent<FunctionTemplate> View::constructor;
+unsigned View::nextId = 1;
+IdlePolicy View::defaultIdlePolicy = { 0, 0 };
+
+void View::Init(Handle<Object> target)
+{
+	HandleScope scope;
+
+	Local<FunctionTemplate> t = FunctionTemplate::New(New);
+	constructor = Persistent<FunctionTemplate>::New(t);
+	constructor->InstanceTemplate()->SetInternalFieldCount(1);
+	constructor->SetClassName(String::NewSymbol("WebView"));
+
+	NODE_SET_PROTOTYPE_METHOD(constructor, "loadURL", LoadURL);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "loadHTML", LoadHTML);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "executeJavascript", ExecuteJavascript);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "evaluate", Evaluate);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "snapshot", Snapshot);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "isLoadingPage", IsLoadingPage);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "getURL", GetURL);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "pageContents", PageContents);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "saveToJPEG", SaveToJPEG);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "saveToPNG", SaveToPNG);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "render", Render);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "thumbnails", MakeThumbnails);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "waitForStable", WaitForStable);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "dispatchInput", DispatchInput);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "type", Type);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "startRecording", StartRecording);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "stopRecording", StopRecording);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "destroy", Destroy);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "setIdlePolicy", SetIdlePolicy);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "setUserScripts", SetUserScripts);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "setHeaderProfile", SetHeaderProfile);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "setBlocking", SetBlocking);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "blockingStats", BlockingStats);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "addRoute", AddRoute);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "removeRoute", RemoveRoute);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "answerRoute", AnswerRoute);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "startTrace", StartTrace);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "stopTrace", StopTrace);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "setConsole", SetConsole);
+	NODE_SET_PROTOTYPE_METHOD(constructor, "drainConsole", DrainConsole);
+
+	target->Set(String::NewSymbol("WebView"), constructor->GetFunction());
+
+	NODE_SET_METHOD(target, "setIdlePolicy", SetDefaultIdlePolicy);
+}
+
+View::View(int width, int height, bool paint)
+	: viewId(nextId++), webView(NULL), state(ACTIVE), width(width),
+	  height(height), paint(paint), idlePolicy(defaultIdlePolicy),
+	  awaitingPaint(false), hasContents(false), router(OnRoute, this)
+{
+	console.SetCapacity(DEFAULT_CONSOLE_ENTRIES);
+	Create();
+}
+
+View::~View()
+{
+	Destroy();
+}
+
+void View::Create()
+{
+	webView = Core::Get()->createWebView(width, height);
+	webView->setListener(this);
+	webView->setResourceInterceptor(this);
+	headers.Reset(webView);
+	router.Open();
+	interceptor.Open();
+	contents.clear();
+	hasContents = false;
+	awaitingPaint = false;
+
+	if(!paint)
+		webView->pauseRendering();
+
+	lastUsed = uv_now(uv_default_loop());
+	Core::Attach(this);
+}
+
+void View::Destroy()
+{
+	if(state != DESTROYED)
+		Metrics::Count(VIEWS_DESTROYED);
+
+	// parked requests hold up Awesomium's thread, which destroy() may wait on
+	router.Close();
+
+	// and a request in flight still reaches into the blocker, trace and
+	// router, which go when the view is collected
+	interceptor.Close();
+
+	if(webView != NULL)
+	{
+		webView->setListener(NULL);
+		webView->setResourceInterceptor(NULL);
+		webView->destroy();
+		webView = NULL;
+		Core::Detach(this);
+	}
+
+	pending.clear();
+	stability.Stop();
+	input.Clear();
+	userScripts.Clear();
+	headers.Clear();
+	state = DESTROYED;
+}
+
+void View::Hibernate()
+{
+	// cookies live in WebCore, not the WebView, so they are still there on wake
+	savedURL = webView->getURL();
+
+	router.Close();
+	interceptor.Close();
+
+	webView->setListener(NULL);
+	webView->setResourceInterceptor(NULL);
+	webView->destroy();
+	webView = NULL;
+	Core::Detach(this);
+
+	stability.Stop();
+	input.Clear();
+	state = HIBERNATED;
+
+	// nothing is in flight any more, so let JS drop the wrapper if it wants
+	Unref();
+}
+
+bool View::Wake(bool reload)
+{
+	switch(state)
+	{
+	case DESTROYED:
+		return false;
+
+	case PAUSED:
+		webView->resumeRendering();
+		state = ACTIVE;
+		break;
+
+	case HIBERNATED:
+		Ref();
+		Create();
+		state = ACTIVE;
+
+		if(reload && !savedURL.empty())
+			webView->loadURL(savedURL);
+
+		savedURL.clear();
+
+		Queue("wake");
+		break;
+
+	default:
+		break;
+	}
+
+	lastUsed = uv_now(uv_default_loop());
+
+	return true;
+}
+
+void View::Tick(uint64_t now)
+{
+	if(state != ACTIVE && state != PAUSED)
+		return;
+
+	// a view with input still to inject counts as in use
+	if(state == ACTIVE && !input.Empty())
+	{
+		std::vector<uint32_t> steps;
+
+		lastUsed = now;
+		input.Pump(webView, now, recorder, steps);
+
+		for(size_t i = 0; i < steps.size(); i++)
+		{
+			Event& event = Queue("inputStep");
+			event.shape = Event::NUMBER;
+			event.code = (int)steps[i];
+		}
+
+		if(input.Empty())
+			Queue("inputDone");
+	}
+
+	// and so does one being watched
+	if(state == ACTIVE && stability.Active())
+	{
+		lastUsed = now;
+
+		if(stability.Poll(webView, now))
+		{
+			Event& event = Queue("stable");
+			event.shape = Event::STABLE;
+			event.code = (int)stability.Waited();
+			event.score = stability.Score();
+			event.timedOut = stability.TimedOut();
+
+			trace.Instant("stable", "render");
+			Flush();
+		}
+
+		return;
+	}
+
+	uint64_t idle = now - lastUsed;
+
+	if(idlePolicy.hibernateAfter && idle >= idlePolicy.hibernateAfter &&
+	   !webView->isLoadingPage())
+	{
+		Queue("hibernate");
+		Hibernate();
+
+		// Core no longer flushes us, so deliver the notice ourselves
+		Flush();
+	}
+	else if(state == ACTIVE && paint && idlePolicy.pauseAfter &&
+			idle >= idlePolicy.pauseAfter)
+	{
+		webView->pauseRendering();
+		state = PAUSED;
+		Queue("pause");
+	}
+}
+
+View::Event& View::Queue(const char* name)
+{
+	pending.push_back(Event());
+
+	Event& event = pending.back();
+	event.name = name;
+	event.shape = Event::NONE;
+	event.code = 0;
+	event.score = 0;
+	event.timedOut = false;
+
+	return event;
+}
+
+void View::Flush()
+{
+	// Awesomium has no paint callback; the view turning dirty after a
+	// main-frame navigation is the first paint of the new page
+	if(awaitingPaint && webView != NULL && webView->isDirty())
+	{
+		awaitingPaint = false;
+		trace.Instant("firstPaint", "render");
+		Queue("firstPaint");
+	}
+
+	if(trace.Enabled())
+	{
+		uint64_t start, end;
+		Core::LastUpdate(start, end);
+		trace.Complete("WebCore::update", "binding", start, end);
+	}
+
+	if(pending.empty())
+		return;
+
+	uint64_t emitStart = trace.Enabled() ? Trace::Now() : 0;
+	size_t emitted = pending.size();
+
+	HandleScope scope;
+
+	// handlers may queue more work or destroy us; emit from a private copy
+	std::vector<Event> events;
+	events.swap(pending);
+
+	// keep the wrapper alive even if a handler destroys the view
+	Persistent<Object> self = Persistent<Object>::New(handle_);
+
+	for(size_t i = 0; i < events.size(); i++)
+	{
+		const Event& event = events[i];
+		Handle<Value> argv[4];
+		int argc = 1;
+
+		argv[0] = String::New(event.name);
+
+		switch(event.shape)
+		{
+		case Event::URL:
+			argv[argc++] = ToV8(event.url);
+			break;
+		case Event::FRAME:
+			argv[argc++] = ToV8(event.url);
+			argv[argc++] = ToV8(event.text);
+			break;
+		case Event::TEXT:
+			argv[argc++] = ToV8(event.text);
+			break;
+		case Event::LOADING:
+			argv[argc++] = ToV8(event.url);
+			argv[argc++] = Integer::New(event.code);
+			argv[argc++] = ToV8(event.text);
+			break;
+		case Event::CONTENTS:
+			argv[argc++] = ToV8(event.url);
+			argv[argc++] = NewBuffer(event.bytes.data(), event.bytes.size());
+			break;
+		case Event::NUMBER:
+			argv[argc++] = Integer::New(event.code);
+			break;
+		case Event::STABLE:
+		{
+			Local<Object> result = Object::New();
+			result->Set(String::NewSymbol("waited"), Integer::New(event.code));
+			result->Set(String::NewSymbol("score"), Number::New(event.score));
+			result->Set(String::NewSymbol("timedOut"), Boolean::New(event.timedOut));
+			argv[argc++] = result;
+			break;
+		}
+		default:
+			break;
+		}
+
+		MakeCallback(self, "emit", argc, argv);
+	}
+
+	self.Dispose();
+
+	// time spent in JS handlers, attributed to the events they handled
+	if(emitStart != 0)
+	{
+		char args[32];
+		snprintf(args, sizeof(args), "\"events\":%lu", (unsigned long)emitted);
+		trace.Complete("emit", "binding", emitStart, Trace::Now(), args);
+	}
+}
+
+Handle<Value> View::New(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!args.IsConstructCall())
+		return ThrowException(Exception::TypeError(
+			String::New("Use the new operator to create a WebView")));
+
+	bool paint = true;
+
+	if(args[2]->IsObject())
+	{
+		Local<Value> option = args[2]->ToObject()->Get(String::NewSymbol("paint"));
+		paint = option->IsUndefined() || option->BooleanValue();
+	}
+
+	int width = args[0]->IsNumber() ? args[0]->Int32Value() :
+				paint ? DEFAULT_WIDTH : NOPAINT_WIDTH;
+	int height = args[1]->IsNumber() ? args[1]->Int32Value() :
+				 paint ? DEFAULT_HEIGHT : NOPAINT_HEIGHT;
+
+	if(width <= 0 || height <= 0)
+		return ThrowException(Exception::RangeError(
+			String::New("WebView dimensions must be positive")));
+
+	View* view = new View(width, height, paint);
+	view->Wrap(args.This());
+	Metrics::Count(VIEWS_CREATED);
+
+	// held until destroy() so pending loads keep their listener alive
+	view->Ref();
+
+	return args.This();
+}
+
+Handle<Value> View::LoadURL(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW_RELOAD(args, view, false);
+
+	String::Utf8Value url(args[0]);
+	view->webView->loadURL(std::string(*url, url.length()));
+
+	return Undefined();
+}
+
+Handle<Value> View::LoadHTML(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW_RELOAD(args, view, false);
+
+	view->webView->loadHTML(ToWide(args[0]));
+
+	return Undefined();
+}
+
+Handle<Value> View::ExecuteJavascript(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	view->webView->executeJavascript(ToWide(args[0]));
+
+	return Undefined();
+}
+
+// Waits at most timeoutMs for a script's result. Awesomium reports a
+// timeout as a null result, so a null that took the whole timeout is
+// taken for one; returns NULL then.
+static const Awesomium::JSValue* WaitFor(Awesomium::FutureJSValue& future, int timeoutMs)
+{
+	uint64_t start = uv_hrtime();
+	const Awesomium::JSValue& result = future.getWithTimeout(timeoutMs);
+
+	if(result.isNull() && uv_hrtime() - start >= (uint64_t)timeoutMs * 1000000)
+		return NULL;
+
+	return &result;
+}
+
+static int GetTimeout(Handle<Value> value)
+{
+	return value->IsNumber() && value->Int32Value() > 0 ? value->Int32Value() : DEFAULT_EVAL_TIMEOUT_MS;
+}
+
+Handle<Value> View::Evaluate(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	int timeoutMs = GetTimeout(args[1]);
+
+	ScopedLatency latency(JS_EVAL);
+
+	Awesomium::FutureJSValue future =
+		view->webView->executeJavascriptWithResult(ToWide(args[0]));
+
+	const Awesomium::JSValue* result = WaitFor(future, timeoutMs);
+
+	if(result == NULL)
+		return ThrowException(Exception::Error(
+			String::New("evaluate timed out waiting for the page")));
+
+	return scope.Close(FromJSValue(*result));
+}
+
+// Typed array of the given constructor, filled from data
+static Local<Object> NewTypedArray(const char* type, const void* data, size_t count, size_t size)
+{
+	HandleScope scope;
+
+	Local<Object> global = Context::GetCurrent()->Global();
+	Local<Function> constructor = Local<Function>::Cast(global->Get(String::NewSymbol(type)));
+
+	Handle<Value> argv[1] = { Integer::NewFromUnsigned((uint32_t)count) };
+	Local<Object> array = constructor->NewInstance(1, argv);
+
+	if(count > 0)
+		memcpy(array->GetIndexedPropertiesExternalArrayData(), data, count * size);
+
+	return scope.Close(array);
+}
+
+template <typename T>
+static Local<Object> NewTypedArray(const char* type, const std::vector<T>& values)
+{
+	return NewTypedArray(type, values.empty() ? NULL : &values[0], values.size(), sizeof(T));
+}
+
+// { types, parents, names, texts, attributeStart, attributeNames,
+//   attributeValues, strings }
+static Local<Object> SnapshotToV8(const DomSnapshot& snapshot)
+{
+	HandleScope scope;
+
+	Local<Array> table = Array::New((int)snapshot.Strings());
+
+	for(size_t i = 0; i < snapshot.Strings(); i++)
+	{
+		size_t length;
+		const wchar_t* str = snapshot.String(i, length);
+		table->Set((uint32_t)i, ToV8(str, length));
+	}
+
+	Local<Object> result = Object::New();
+	result->Set(String::NewSymbol("types"), NewTypedArray("Uint8Array", snapshot.Types()));
+	result->Set(String::NewSymbol("parents"), NewTypedArray("Int32Array", snapshot.Parents()));
+	result->Set(String::NewSymbol("names"), NewTypedArray("Uint32Array", snapshot.Names()));
+	result->Set(String::NewSymbol("texts"), NewTypedArray("Int32Array", snapshot.Texts()));
+	result->Set(String::NewSymbol("attributeStart"), NewTypedArray("Uint32Array", snapshot.AttributeStart()));
+	result->Set(String::NewSymbol("attributeNames"), NewTypedArray("Uint32Array", snapshot.AttributeNames()));
+	result->Set(String::NewSymbol("attributeValues"), NewTypedArray("Uint32Array", snapshot.AttributeValues()));
+	result->Set(String::NewSymbol("strings"), table);
+
+	return scope.Close(result);
+}
+
+// snapshot([timeoutMs]) walks the DOM in the page and returns it as typed
+// columns; see DomSnapshot
+Handle<Value> View::Snapshot(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	int timeoutMs = GetTimeout(args[0]);
+	std::wstring encoded;
+
+	{
+		ScopedLatency latency(JS_EVAL);
+
+		Awesomium::FutureJSValue future =
+			view->webView->executeJavascriptWithResult(DomSnapshot::Walker());
+
+		const Awesomium::JSValue* result = WaitFor(future, timeoutMs);
+
+		if(result == NULL || !result->isString())
+			return ThrowException(Exception::Error(
+				String::New("snapshot did not complete; the page may still be loading or have Javascript disabled")));
+
+		encoded = result->toString();
+	}
+
+	DomSnapshot snapshot;
+
+	if(!snapshot.Decode(encoded))
+		return ThrowException(Exception::Error(String::New("Malformed DOM snapshot")));
+
+	return scope.Close(SnapshotToV8(snapshot));
+}
+
+Handle<Value> View::IsLoadingPage(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	return scope.Close(Boolean::New(view->webView->isLoadingPage()));
+}
+
+Handle<Value> View::GetURL(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	return scope.Close(ToV8(view->webView->getURL()));
+}
+
+Handle<Value> View::PageContents(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	if(!view->hasContents)
+		return Undefined();
+
+	return scope.Close(NewBuffer(view->contents.data(), view->contents.size()));
+}
+
+const Awesomium::RenderBuffer* View::RenderTimed()
+{
+	ScopedLatency latency(RENDER);
+	return webView->render();
+}
+
+Handle<Value> View::SaveToJPEG(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	REQUIRE_PAINT(view);
+
+	int quality = args[1]->IsNumber() ? args[1]->Int32Value() : 90;
+	const Awesomium::RenderBuffer* buffer = view->RenderTimed();
+
+	if(buffer == NULL)
+		return scope.Close(False());
+
+	ScopedLatency latency(ENCODE);
+
+	return scope.Close(Boolean::New(buffer->saveToJPEG(ToWide(args[0]), quality)));
+}
+
+Handle<Value> View::SaveToPNG(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+	REQUIRE_PAINT(view);
+
+	const Awesomium::RenderBuffer* buffer = view->RenderTimed();
+
+	if(buffer == NULL)
+		return scope.Close(False());
+
+	ScopedLatency latency(ENCODE);
+
+	return scope.Close(Boolean::New(
+		buffer->saveToPNG(ToWide(args[0]), args[1]->BooleanValue())));
+}
+
+// Renders without encoding anything; true once a buffer came back
+Handle<Value> View::Render(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+	REQUIRE_PAINT(view);
+
+	return scope.Close(Boolean::New(view->RenderTimed() != NULL));
+}
+
+// thumbnails(sizes, { filter, quality }) renders once and returns one JPEG
+// Buffer per size, or false when nothing could be rendered
+Handle<Value> View::MakeThumbnails(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+	REQUIRE_PAINT(view);
+
+	Local<Object> options = args[1]->IsObject() ? args[1]->ToObject() : Object::New();
+	Local<Value> quality = options->Get(String::NewSymbol("quality"));
+	Thumbnails thumbnails;
+	const char* error;
+
+	if(!thumbnails.Parse(args[0], options->Get(String::NewSymbol("filter")), error))
+		return ThrowException(Exception::TypeError(String::New(error)));
+
+	if(quality->IsNumber() && quality->Int32Value() >= 1 && quality->Int32Value() <= 100)
+		thumbnails.quality = quality->Int32Value();
+
+	const Awesomium::RenderBuffer* buffer = view->RenderTimed();
+
+	if(buffer == NULL)
+		return scope.Close(False());
+
+	std::vector<std::string> encoded;
+
+	{
+		ScopedLatency latency(ENCODE);
+
+		if(!thumbnails.Encode(buffer->buffer, buffer->width, buffer->height, buffer->rowSpan, encoded))
+			return scope.Close(False());
+	}
+
+	return scope.Close(Thumbnails::ToV8(encoded));
+}
+
+// waitForStable({ threshold, quiet, interval, maxWait }) emits "stable"
+// once the page has stopped changing on screen; starting over cancels any
+// wait already running
+Handle<Value> View::WaitForStable(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+	REQUIRE_PAINT(view);
+
+	StabilityOptions options;
+	options.Parse(args[0]);
+
+	view->stability.Start(options, uv_now(uv_default_loop()));
+
+	return Undefined();
+}
+
+// dispatchInput(events, { speed, steps }) queues an Int32Array of input
+// records (see input.h), or a recorded input log, to be injected across
+// update ticks after anything already queued; "inputDone" follows the last
+// one. speed divides the delays, 0 drops them. steps injects one event per
+// tick and emits "inputStep" with its index after each. Returns the number
+// queued.
+Handle<Value> View::DispatchInput(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	std::vector<InputEvent> events;
+	const char* error;
+
+	if(!DecodeInput(args[0], events, error))
+		return ThrowException(Exception::TypeError(String::New(error)));
+
+	Local<Object> options = args[1]->IsObject() ? args[1]->ToObject() : Object::New();
+	Local<Value> speed = options->Get(String::NewSymbol("speed"));
+
+	if(!speed->IsUndefined())
+	{
+		double factor = speed->NumberValue();
+
+		if(!(factor >= 0))
+			return ThrowException(Exception::RangeError(
+				String::New("speed must be a positive number, or 0 for no delays")));
+
+		for(size_t i = 0; i < events.size(); i++)
+			events[i].delay = factor > 0 ? (int32_t)(events[i].delay / factor + 0.5) : 0;
+	}
+
+	view->input.Push(events, uv_now(uv_default_loop()),
+					 options->Get(String::NewSymbol("steps"))->BooleanValue());
+
+	return scope.Close(Integer::NewFromUnsigned((uint32_t)events.size()));
+}
+
+// type(text, { delayMs }) queues the keyDown/char/keyUp triplet of every
+// character, keystrokes delayMs apart, like dispatchInput(). Returns the
+// number of events queued.
+Handle<Value> View::Type(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	if(!args[0]->IsString())
+		return ThrowException(Exception::TypeError(
+			String::New("type expects a string")));
+
+	int32_t delay = 0;
+
+	if(args[1]->IsObject())
+	{
+		Local<Value> value = args[1]->ToObject()->Get(String::NewSymbol("delayMs"));
+
+		if(value->IsNumber() && value->Int32Value() > 0)
+			delay = value->Int32Value();
+	}
+
+	String::Value text(args[0]);
+	std::vector<InputEvent> events;
+
+	TypeText(*text, text.length(), delay, events);
+	view->input.Push(events, uv_now(uv_default_loop()));
+
+	return scope.Close(Integer::NewFromUnsigned((uint32_t)events.size()));
+}
+
+// Everything injected from here on is logged, with its timing, until
+// stopRecording()
+Handle<Value> View::StartRecording(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	view->recorder.Start(uv_now(uv_default_loop()));
+
+	return Undefined();
+}
+
+// The input log as a Buffer, ready for dispatchInput() on any view, or
+// undefined if nothing was being recorded
+Handle<Value> View::StopRecording(const Arguments& args)
+{
+	HandleScope scope;
+	View* view = ObjectWrap::Unwrap<View>(args.This());
+
+	std::string log;
+
+	if(!view->recorder.Stop(log))
+		return Undefined();
+
+	return scope.Close(NewBuffer(log.data(), log.size()));
+}
+
+Handle<Value> View::Destroy(const Arguments& args)
+{
+	HandleScope scope;
+	View* view = ObjectWrap::Unwrap<View>(args.This());
+
+	// hibernated views already gave up their reference
+	bool referenced = view->state == ACTIVE || view->state == PAUSED;
+
+	view->Destroy();
+
+	if(referenced)
+		view->Unref();
+
+	return Undefined();
+}
+
+Handle<Value> View::StartTrace(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	view->trace.Start(view->viewId);
+
+	return Undefined();
+}
+
+// Chrome trace-event JSON for everything since startTrace(), or undefined
+Handle<Value> View::StopTrace(const Arguments& args)
+{
+	HandleScope scope;
+	View* view = ObjectWrap::Unwrap<View>(args.This());
+
+	std::string json;
+
+	if(!view->trace.Stop(json))
+		return Undefined();
+
+	return scope.Close(ToV8(json));
+}
+
+// setConsole({ size, level: "log" | "error", filter: /re/ | "re" | null })
+Handle<Value> View::SetConsole(const Arguments& args)
+{
+	HandleScope scope;
+	View* view = ObjectWrap::Unwrap<View>(args.This());
+
+	if(!args[0]->IsObject())
+		return ThrowException(Exception::TypeError(
+			String::New("setConsole expects an options object")));
+
+	Local<Object> options = args[0]->ToObject();
+	Local<Value> size = options->Get(String::NewSymbol("size"));
+	Local<Value> level = options->Get(String::NewSymbol("level"));
+	Local<Value> filter = options->Get(String::NewSymbol("filter"));
+
+	if(!level->IsUndefined())
+	{
+		String::Utf8Value name(level);
+
+		if(strcmp(*name, "log") == 0)
+			view->console.SetLevel(CONSOLE_LOG);
+		else if(strcmp(*name, "error") == 0)
+			view->console.SetLevel(CONSOLE_ERROR);
+		else
+			return ThrowException(Exception::RangeError(
+				String::New("level must be \"log\" or \"error\"")));
+	}
+
+	if(!filter->IsUndefined())
+	{
+		std::string pattern;
+		bool ignoreCase = false;
+
+		// RegExp objects hand over their source; the syntax is POSIX ERE
+		if(filter->IsObject() && !filter->IsString())
+		{
+			Local<Object> regexp = filter->ToObject();
+			String::Utf8Value source(regexp->Get(String::NewSymbol("source")));
+			pattern.assign(*source, source.length());
+			ignoreCase = regexp->Get(String::NewSymbol("ignoreCase"))->BooleanValue();
+		}
+		else if(!filter->IsNull())
+		{
+			String::Utf8Value source(filter);
+			pattern.assign(*source, source.length());
+		}
+
+		if(!view->console.SetFilter(pattern, ignoreCase))
+			return ThrowException(Exception::SyntaxError(
+				String::New("filter is not a valid POSIX extended regular expression")));
+	}
+
+	if(size->IsNumber())
+		view->console.SetCapacity((size_t)(size->Int32Value() > 0 ? size->Int32Value() : 0));
+
+	return Undefined();
+}
+
+// { entries: [{ level, message, source, line, time }], dropped }
+Handle<Value> View::DrainConsole(const Arguments& args)
+{
+	HandleScope scope;
+	View* view = ObjectWrap::Unwrap<View>(args.This());
+
+	std::vector<ConsoleEntry> entries;
+	size_t dropped = view->console.Drain(entries);
+
+	Local<Array> list = Array::New((int)entries.size());
+
+	for(size_t i = 0; i < entries.size(); i++)
+	{
+		Local<Object> entry = Object::New();
+		entry->Set(String::NewSymbol("level"), String::New(ConsoleLog::Describe(entries[i].level)));
+		entry->Set(String::NewSymbol("message"), ToV8(entries[i].message));
+		entry->Set(String::NewSymbol("source"), ToV8(entries[i].source));
+		entry->Set(String::NewSymbol("line"), Integer::New(entries[i].line));
+		entry->Set(String::NewSymbol("time"), Number::New(entries[i].time));
+		list->Set((uint32_t)i, entry);
+	}
+
+	Local<Object> result = Object::New();
+	result->Set(String::NewSymbol("entries"), list);
+	result->Set(String::NewSymbol("dropped"), Number::New((double)dropped));
+
+	return scope.Close(result);
+}
+
+// Negative thresholds are ignored, like StabilityOptions' times, rather
+// than wrapping around to a timeout that never comes
+static uint64_t GetThreshold(Local<Object> options, const char* name)
+{
+	Local<Value> value = options->Get(String::NewSymbol(name));
+	return value->IsNumber() && value->IntegerValue() >= 0 ? (uint64_t)value->IntegerValue() : 0;
+}
+
+bool View::ParseIdlePolicy(Handle<Value> value, IdlePolicy& policy)
+{
+	if(!value->IsObject())
+		return false;
+
+	Local<Object> options = value->ToObject();
+
+	policy.pauseAfter = GetThreshold(options, "pauseAfter");
+	policy.hibernateAfter = GetThreshold(options, "hibernateAfter");
+
+	return true;
+}
+
+Handle<Value> View::SetIdlePolicy(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	if(!ParseIdlePolicy(args[0], view->idlePolicy))
+		return ThrowException(Exception::TypeError(
+			String::New("setIdlePolicy expects an options object")));
+
+	return Undefined();
+}
+
+// setUserScripts(names) replaces the scripts and styles from
+// defineUserScript()/defineUserStyle() that the view injects, from its
+// next navigation on
+Handle<Value> View::SetUserScripts(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	std::string error;
+
+	if(!view->userScripts.Assign(args[0], error))
+		return ThrowException(Exception::TypeError(String::New(error.c_str())));
+
+	return Undefined();
+}
+
+// setHeaderProfile(name) switches the view to a profile from
+// defineHeaderProfile(), or to none for null, making only the calls that
+// differ from the current one; returns how many that took
+Handle<Value> View::SetHeaderProfile(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	HeaderProfile* profile = NULL;
+
+	if(!args[0]->IsNull() && !args[0]->IsUndefined())
+	{
+		String::Utf8Value name(args[0]);
+		profile = HeaderProfiles::Acquire(std::string(*name, name.length()));
+
+		if(profile == NULL)
+			return ThrowException(Exception::TypeError(
+				String::New("No header profile by that name")));
+	}
+
+	return scope.Close(Integer::New(view->headers.Apply(view->webView, profile)));
+}
+
+// setBlocking({ types, mode }) keeps image, font, media or stylesheet
+// requests off the network; null blocks nothing again
+Handle<Value> View::SetBlocking(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	const char* error;
+
+	if(!view->blocker.Configure(args[0], error))
+		return ThrowException(Exception::TypeError(String::New(error)));
+
+	return Undefined();
+}
+
+// blockingStats() returns { requests, bytes, estimated } blocked by this
+// view. bytes is an estimate covering the estimated requests, and null
+// when there is none. Reading them does not wake the view.
+Handle<Value> View::BlockingStats(const Arguments& args)
+{
+	HandleScope scope;
+	View* view = ObjectWrap::Unwrap<View>(args.This());
+
+	uint64_t requests, bytes, estimated;
+	view->blocker.GetStats(requests, bytes, estimated);
+
+	Local<Object> result = Object::New();
+	result->Set(String::NewSymbol("requests"), Number::New((double)requests));
+	result->Set(String::NewSymbol("bytes"), estimated > 0 ?
+		Handle<Value>(Number::New((double)bytes)) : Handle<Value>(Null()));
+	result->Set(String::NewSymbol("estimated"), Number::New((double)estimated));
+
+	return scope.Close(result);
+}
+
+// addRoute(pattern, handler | Buffer, mimeType, timeoutMs) is the native half
+// of view.route() in lib/routes.js
+Handle<Value> View::AddRoute(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	if(!args[0]->IsString() || !(args[1]->IsNumber() || Buffer::HasInstance(args[1])))
+		return ThrowException(Exception::TypeError(
+			String::New("addRoute expects a pattern and a handler id or Buffer")));
+
+	String::Utf8Value pattern(args[0]);
+	String::Utf8Value mimeType(args[2]->IsString() ? args[2]->ToString() : String::Empty());
+	int timeoutMs = args[3]->IsNumber() ? args[3]->Int32Value() : 0;
+
+	if(args[1]->IsNumber() && timeoutMs <= 0)
+		return ThrowException(Exception::RangeError(
+			String::New("Route handlers need a positive timeout")));
+
+	view->router.Add(std::string(*pattern, pattern.length()),
+					 args[1]->IsNumber() ? args[1]->Int32Value() : 0, args[1],
+					 std::string(*mimeType, mimeType.length()), timeoutMs);
+
+	return Undefined();
+}
+
+Handle<Value> View::RemoveRoute(const Arguments& args)
+{
+	HandleScope scope;
+	UNWRAP_VIEW(args, view);
+
+	String::Utf8Value pattern(args[0]);
+
+	return scope.Close(Boolean::New(view->router.Remove(std::string(*pattern, pattern.length()))));
+}
+
+// answerRoute(seq, body, mimeType) serves a Buffer to a parked request, or
+// cancels it for anything else. Late answers are dropped, so this works
+// on a view that has been destroyed since.
+Handle<Value> View::AnswerRoute(const Arguments& args)
+{
+	HandleScope scope;
+	View* view = ObjectWrap::Unwrap<View>(args.This());
+
+	String::Utf8Value mimeType(args[2]->IsString() ? args[2]->ToString() : String::Empty());
+
+	view->router.Answer(args[0]->Uint32Value(), args[1],
+						std::string(*mimeType, mimeType.length()));
+
+	return Undefined();
+}
+
+void View::OnRoute(void* data, unsigned seq, int handler, const std::string& url,
+				   const std::string& method)
+{
+	HandleScope scope;
+	View* view = (View*)data;
+
+	Handle<Value> argv[5] = {
+		String::New("route"),
+		Integer::NewFromUnsigned(seq),
+		Integer::New(handler),
+		ToV8(url),
+		ToV8(method)
+	};
+
+	view->trace.Instant("route", "network", "url", url);
+	MakeCallback(view->handle_, "emit", 5, argv);
+}
+
+Handle<Value> View::SetDefaultIdlePolicy(const Arguments& args)
+{
+	HandleScope scope;
+
+	if(!ParseIdlePolicy(args[0], defaultIdlePolicy))
+		return ThrowException(Exception::TypeError(
+			String::New("setIdlePolicy expects an options object")));
+
+	return Undefined();
+}
+
+void View::onBeginNavigation(Awesomium::WebView* caller, const std::string& url,
+							 const std::wstring& frameName)
+{
+	// a new main-frame document makes the previous page text stale
+	if(frameName.empty())
+	{
+		Metrics::Count(LOADS_STARTED);
+
+		contents.clear();
+		hasContents = false;
+
+		// take the old page's pixels so its dirtiness cannot pass for
+		// the new page's first paint; nothing new arrives before the
+		// response does
+		if(paint)
+		{
+			if(webView->isDirty())
+				webView->render();
+
+			awaitingPaint = true;
+		}
+	}
+
+	trace.Instant("beginNavigation", "navigation", "url", url);
+
+	Event& event = Queue("beginNavigation");
+	event.shape = Event::FRAME;
+	event.url = url;
+	event.text = frameName;
+}
+
+void View::onBeginLoading(Awesomium::WebView* caller, const std::string& url,
+						  const std::wstring& frameName, int statusCode,
+						  const std::wstring& mimeType)
+{
+	// Awesomium has no failure callback; an error status on the main
+	// frame is the closest thing to a failed load
+	if(frameName.empty() && statusCode >= 400)
+		Metrics::Count(LOADS_FAILED);
+
+	// the new document has committed by now, so this is as early as user
+	// scripts can run in it; executeJavascript only queues them
+	if(frameName.empty() && !userScripts.Empty())
+		userScripts.Inject(caller);
+
+	trace.Instant("beginLoading", "navigation", "url", url);
+
+	Event& event = Queue("beginLoading");
+	event.shape = Event::LOADING;
+	event.url = url;
+	event.code = statusCode;
+	event.text = mimeType;
+}
+
+void View::onFinishLoading(Awesomium::WebView* caller)
+{
+	Metrics::Count(LOADS_FINISHED);
+	trace.Instant("finishLoading", "navigation");
+	Queue("finishLoading");
+}
+
+void View::onCallback(Awesomium::WebView* caller, const std::wstring& objectName,
+					  const std::wstring& callbackName,
+					  const Awesomium::JSArguments& args)
+{
+}
+
+void View::onReceiveTitle(Awesomium::WebView* caller, const std::wstring& title,
+						  const std::wstring& frameName)
+{
+	trace.Instant("title", "navigation");
+
+	Event& event = Queue("title");
+	event.shape = Event::TEXT;
+	event.text = title;
+}
+
+void View::onChangeTooltip(Awesomium::WebView* caller, const std::wstring& tooltip)
+{
+}
+
+void View::onChangeCursor(Awesomium::WebView* caller, Awesomium::CursorType cursor)
+{
+}
+
+void View::onChangeKeyboardFocus(Awesomium::WebView* caller, bool isFocused)
+{
+}
+
+void View::onChangeTargetURL(Awesomium::WebView* caller, const std::string& url)
+{
+	trace.Instant("targetURL", "input", "url", url);
+}
+
+void View::onOpenExternalLink(Awesomium::WebView* caller, const std::string& url,
+							  const std::wstring& source)
+{
+}
+
+void View::onRequestDownload(Awesomium::WebView* caller, const std::string& url)
+{
+}
+
+void View::onWebViewCrashed(Awesomium::WebView* caller)
+{
+	Metrics::Count(LOADS_CRASHED);
+	trace.Instant("crashed", "navigation");
+	Queue("crashed");
+}
+
+void View::onPluginCrashed(Awesomium::WebView* caller, const std::wstring& pluginName)
+{
+}
+
+void View::onRequestMove(Awesomium::WebView* caller, int x, int y)
+{
+}
+
+void View::onGetPageContents(Awesomium::WebView* caller, const std::string& url,
+							 const std::wstring& text)
+{
+	// transcode once; the view keeps the latest copy for pageContents()
+	contents.clear();
+	EncodeUtf8(text.data(), text.size(), contents);
+	hasContents = true;
+
+	Event& event = Queue("contents");
+	event.shape = Event::CONTENTS;
+	event.url = url;
+	event.bytes = contents;
+}
+
+void View::onDOMReady(Awesomium::WebView* caller)
+{
+	trace.Instant("domReady", "navigation");
+	Queue("domReady");
+}
+
+void View::onRequestFileChooser(Awesomium::WebView* caller, bool selectMultipleFiles,
+								const std::wstring& title,
+								const std::wstring& defaultPath)
+{
+}
+
+void View::onGetScrollData(Awesomium::WebView* caller, int contentWidth,
+						   int contentHeight, int preferredWidth, int scrollX,
+						   int scrollY)
+{
+}
+
+void View::onJavascriptConsoleMessage(Awesomium::WebView* caller,
+									  const std::wstring& message, int lineNumber,
+									  const std::wstring& source)
+{
+	console.Add(message, source, lineNumber);
+}
+
+void View::onGetFindResults(Awesomium::WebView* caller, int requestID,
+							int numMatches, const Awesomium::Rect& selection,
+							int curMatch, bool finalUpdate)
+{
+}
+
+void View::onUpdateIME(Awesomium::WebView* caller, Awesomium::IMEState imeState,
+					   const Awesomium::Rect& caretRect)
+{
+}
+
+Awesomium::ResourceResponse* View::onRequest(Awesomium::WebView* caller,
+											 Awesomium::ResourceRequest* request)
+{
+	// the view is being torn down; let the request through untouched
+	if(!interceptor.Enter())
+		return NULL;
+
+	Metrics::Count(INTERCEPTOR_HITS);
+
+	Awesomium::ResourceResponse* response;
+
+	// routes come first so a mock can stand in for a blocked type
+	if(router.Serve(request, response))
+		trace.Instant("routed", "network", "url", request->getURL());
+	else if(blocker.Block(request, response))
+		trace.Instant("blocked", "network", "url", request->getURL());
+	else
+	{
+		trace.Request(request->getURL());
+		response = NULL;
+	}
+
+	interceptor.Leave();
+
+	return response;
+}
+
+void View::onResponse(Awesomium::WebView* caller, const std::string& url,
+					  int statusCode, const Awesomium::ResourceResponseMetrics& metrics)
+{
+	if(!interceptor.Enter())
+		return;
+
+	if(metrics.expectedContentSize > 0)
+		Metrics::Count(INTERCEPTOR_BYTES, (uint64_t)metrics.expectedContentSize);
+
+	blocker.Observe(url, metrics.mimeType, metrics.expectedContentSize);
+
+	trace.Response(url, statusCode, metrics.wasCached, metrics.expectedContentSize,
+				   metrics.mimeType);
+
+	interceptor.Leave();
+}
+
+}
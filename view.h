@@ -0,0 +1,219 @@
+#ifndef NODIUM_VIEW_H
+#define NODIUM_VIEW_H
+
+#include <v8.h>
+#include <node.h>
+#include <stdint.h>
+#include <Awesomium/WebCore.h>
+#include "trace.h"
+#include "console.h"
+#include "stability.h"
+#include "input.h"
+#include "userscripts.h"
+#include "headers.h"
+#include "blocking.h"
+#include "router.h"
+#include "gate.h"
+#include <string>
+#include <vector>
+
+namespace nodium {
+
+// Idle thresholds in milliseconds; zero disables the step. A paused view
+// stops painting, a hibernated one is torn down to its URL and rebuilt on
+// next use.
+struct IdlePolicy
+{
+	uint64_t pauseAfter;
+	uint64_t hibernateAfter;
+};
+
+// JS wrapper around a single Awesomium::WebView. Listener callbacks fired
+// during WebCore::update() are queued and emitted as events by Flush().
+// The view is also its WebView's ResourceInterceptor; those callbacks may
+// run on another thread and must not touch V8 or the event queue.
+class View : public node::ObjectWrap, public Awesomium::WebViewListener,
+			 public Awesomium::ResourceInterceptor
+{
+public:
+	static void Init(v8::Handle<v8::Object> target);
+
+	unsigned id() const { return viewId; }
+
+	// Delivers queued listener events; called by Core after each update().
+	void Flush();
+
+	// Injects queued input and applies the idle policy; called by Core
+	// after Flush().
+	void Tick(uint64_t now);
+
+private:
+	View(int width, int height, bool paint);
+	~View();
+
+	enum State { ACTIVE, PAUSED, HIBERNATED, DESTROYED };
+
+	void Create();
+	void Destroy();
+	void Hibernate();
+
+	// Marks the view as used, undoing any pause or hibernation; reload
+	// false skips reloading a hibernated view's URL. Returns false once the
+	// view has been destroyed.
+	bool Wake(bool reload = true);
+
+	struct Event
+	{
+		const char* name;
+		enum { NONE, URL, FRAME, TEXT, LOADING, CONTENTS, STABLE, NUMBER } shape;
+		std::string url;
+		std::wstring text;
+		std::string bytes;
+		int code;
+
+		// STABLE: code is the time waited; NUMBER: code is all there is
+		double score;
+		bool timedOut;
+	};
+
+	Event& Queue(const char* name);
+
+	// webView->render(), timed into the render latency histogram
+	const Awesomium::RenderBuffer* RenderTimed();
+
+	static v8::Handle<v8::Value> New(const v8::Arguments& args);
+	static v8::Handle<v8::Value> LoadURL(const v8::Arguments& args);
+	static v8::Handle<v8::Value> LoadHTML(const v8::Arguments& args);
+	static v8::Handle<v8::Value> ExecuteJavascript(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Evaluate(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Snapshot(const v8::Arguments& args);
+	static v8::Handle<v8::Value> IsLoadingPage(const v8::Arguments& args);
+	static v8::Handle<v8::Value> GetURL(const v8::Arguments& args);
+	static v8::Handle<v8::Value> PageContents(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SaveToJPEG(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SaveToPNG(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Render(const v8::Arguments& args);
+	static v8::Handle<v8::Value> MakeThumbnails(const v8::Arguments& args);
+	static v8::Handle<v8::Value> WaitForStable(const v8::Arguments& args);
+	static v8::Handle<v8::Value> DispatchInput(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Type(const v8::Arguments& args);
+	static v8::Handle<v8::Value> StartRecording(const v8::Arguments& args);
+	static v8::Handle<v8::Value> StopRecording(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Destroy(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SetIdlePolicy(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SetUserScripts(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SetHeaderProfile(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SetBlocking(const v8::Arguments& args);
+	static v8::Handle<v8::Value> BlockingStats(const v8::Arguments& args);
+	static v8::Handle<v8::Value> AddRoute(const v8::Arguments& args);
+	static v8::Handle<v8::Value> RemoveRoute(const v8::Arguments& args);
+	static v8::Handle<v8::Value> AnswerRoute(const v8::Arguments& args);
+	static v8::Handle<v8::Value> StartTrace(const v8::Arguments& args);
+	static v8::Handle<v8::Value> StopTrace(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SetConsole(const v8::Arguments& args);
+	static v8::Handle<v8::Value> DrainConsole(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SetDefaultIdlePolicy(const v8::Arguments& args);
+
+	static bool ParseIdlePolicy(v8::Handle<v8::Value> value, IdlePolicy& policy);
+
+	// Router::Listener; emits route(seq, handler, url, method)
+	static void OnRoute(void* data, unsigned seq, int handler,
+						const std::string& url, const std::string& method);
+
+	// Awesomium::WebViewListener
+	void onBeginNavigation(Awesomium::WebView* caller, const std::string& url,
+						   const std::wstring& frameName);
+	void onBeginLoading(Awesomium::WebView* caller, const std::string& url,
+						const std::wstring& frameName, int statusCode,
+						const std::wstring& mimeType);
+	void onFinishLoading(Awesomium::WebView* caller);
+	void onCallback(Awesomium::WebView* caller, const std::wstring& objectName,
+					const std::wstring& callbackName,
+					const Awesomium::JSArguments& args);
+	void onReceiveTitle(Awesomium::WebView* caller, const std::wstring& title,
+						const std::wstring& frameName);
+	void onChangeTooltip(Awesomium::WebView* caller, const std::wstring& tooltip);
+	void onChangeCursor(Awesomium::WebView* caller, Awesomium::CursorType cursor);
+	void onChangeKeyboardFocus(Awesomium::WebView* caller, bool isFocused);
+	void onChangeTargetURL(Awesomium::WebView* caller, const std::string& url);
+	void onOpenExternalLink(Awesomium::WebView* caller, const std::string& url,
+							const std::wstring& source);
+	void onRequestDownload(Awesomium::WebView* caller, const std::string& url);
+	void onWebViewCrashed(Awesomium::WebView* caller);
+	void onPluginCrashed(Awesomium::WebView* caller, const std::wstring& pluginName);
+	void onRequestMove(Awesomium::WebView* caller, int x, int y);
+	void onGetPageContents(Awesomium::WebView* caller, const std::string& url,
+						   const std::wstring& contents);
+	void onDOMReady(Awesomium::WebView* caller);
+	void onRequestFileChooser(Awesomium::WebView* caller, bool selectMultipleFiles,
+							  const std::wstring& title,
+							  const std::wstring& defaultPath);
+	void onGetScrollData(Awesomium::WebView* caller, int contentWidth,
+						 int contentHeight, int preferredWidth, int scrollX,
+						 int scrollY);
+	void onJavascriptConsoleMessage(Awesomium::WebView* caller,
+									const std::wstring& message, int lineNumber,
+									const std::wstring& source);
+	void onGetFindResults(Awesomium::WebView* caller, int requestID,
+						  int numMatches, const Awesomium::Rect& selection,
+						  int curMatch, bool finalUpdate);
+	void onUpdateIME(Awesomium::WebView* caller, Awesomium::IMEState imeState,
+					 const Awesomium::Rect& caretRect);
+
+	// Awesomium::ResourceInterceptor
+	Awesomium::ResourceResponse* onRequest(Awesomium::WebView* caller,
+										   Awesomium::ResourceRequest* request);
+	void onResponse(Awesomium::WebView* caller, const std::string& url,
+					int statusCode, const Awesomium::ResourceResponseMetrics& metrics);
+
+	static v8::Persistent<v8::FunctionTemplate> constructor;
+	static unsigned nextId;
+	static IdlePolicy defaultIdlePolicy;
+
+	unsigned viewId;
+	Awesomium::WebView* webView;
+	std::vector<Event> pending;
+
+	State state;
+	int width;
+	int height;
+	bool paint;
+	IdlePolicy idlePolicy;
+	uint64_t lastUsed;
+
+	// set by a main-frame navigation until the view first turns dirty
+	bool awaitingPaint;
+
+	// UTF-8 text of the current page, once onGetPageContents delivered it
+	std::string contents;
+	bool hasContents;
+
+	Trace trace;
+	ConsoleLog console;
+	StabilityWatch stability;
+	InputQueue input;
+	InputRecorder recorder;
+
+	// injected into every main-frame document as it starts loading
+	UserScriptSet userScripts;
+
+	// header rewrite profile; survives hibernation and is reapplied after
+	HeaderState headers;
+
+	// consulted by onRequest, possibly off the main thread
+	ResourceBlocker blocker;
+
+	// view.route(); closed while there is no WebView to serve
+	Router router;
+
+	// onRequest and onResponse in progress; closed and drained before the
+	// WebView, and with it possibly this view, goes away
+	CallbackGate interceptor;
+
+	// what a hibernated view needs to come back
+	std::string savedURL;
+};
+
+}
+
+#endif